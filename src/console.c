@@ -299,7 +299,7 @@ consoleread(struct inode *ip, char *dst, int n)
         ilock(ip);
         return -1;
       }
-      sleep(&input.r, &cons.lock);
+      sleepio(&input.r, &cons.lock);
     }
     c = input.buf[input.r++ % INPUT_BUF];
     if(c == C('D')){  // EOF
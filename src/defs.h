@@ -4,6 +4,8 @@ struct file;
 struct inode;
 struct pipe;
 struct proc;
+struct rbnode;
+struct rbroot;
 struct rtcdate;
 struct spinlock;
 struct sleeplock;
@@ -11,6 +13,9 @@ struct stat;
 struct superblock;
 #ifdef CS333_P2
 struct uproc;
+struct loadinfo;
+struct levelinfo;
+struct procrec;
 #endif // CS333_P2
 
 // bio.c
@@ -86,6 +91,13 @@ extern volatile uint*    lapic;
 void            lapiceoi(void);
 void            lapicinit(void);
 void            lapicstartap(uchar, uint);
+#ifdef CS333_P3
+void            lapiconeshot(uint);
+void            lapicperiodic(void);
+#endif // CS333_P3
+#ifdef CS333_P4
+void            lapicipi(uchar, int);
+#endif // CS333_P4
 void            microdelay(int);
 
 // log.c
@@ -122,9 +134,11 @@ void            scheduler(void) __attribute__((noreturn));
 void            sched(void);
 void            setproc(struct proc*);
 void            sleep(void*, struct spinlock*);
+void            sleepio(void*, struct spinlock*);
 void            userinit(void);
 int             wait(void);
 void            wakeup(void*);
+void            wakeup_one(void*);
 void            yield(void);
 #ifdef CS333_P2
 int		getgid(void);
@@ -135,6 +149,8 @@ int             setgid(int);
 int		getprocs(int, struct uproc *);
 #endif // CS333_P2
 #ifdef CS333_P3
+int             sleepticks(uint);
+void            timertick(void);
 void            runnabledump(void);
 void            unuseddump(void);
 void            sleepdump(void);
@@ -143,8 +159,39 @@ void            zombiedump(void);
 #ifdef CS333_P4
 int             setpriority(int, int);
 int             getpriority(int);
+int             setaffinity(int, uint);
+int             getaffinity(int);
+int             setsched(int, int, uint, uint);
+void            inheritwait(struct sleeplock*);
+void            inherittake(struct sleeplock*);
+void            inheritdrop(struct sleeplock*);
+int             preemptdue(int);
+int             setlevel(int, struct levelinfo*);
+int             getlevel(int, struct levelinfo*);
+#endif
+#ifdef CS333_STRIDE
+int             settickets(int, int);
+int             gettickets(int);
+#endif
+#ifdef CS333_P3
+int             clone(void (*)(void*), void*, void*);
+int             join(void**);
+int             getload(struct loadinfo*);
+int             yieldto(int);
+int             procsnap(uint*, int, struct procrec*);
+int             setmaxproc(int);
+#endif
+#ifdef CS333_SHARE
+int             setuidweight(int, int);
 #endif
 
+// rbtree.c
+void            rbinit(struct rbroot*);
+void            rbinsert(struct rbroot*, struct rbnode*,
+                         int (*)(struct rbnode*, struct rbnode*));
+void            rberase(struct rbroot*, struct rbnode*);
+struct rbnode*  rbnext(struct rbnode*);
+
 // swtch.S
 void            swtch(struct context**, struct context*);
 
@@ -186,6 +233,11 @@ void            timerinit(void);
 // trap.c
 void            idtinit(void);
 extern uint     ticks;
+#ifdef CS333_P3
+int             clockcalibrated(void);
+uint            tscusec(uint64);
+uint            tscticks(uint64);
+#endif // CS333_P3
 void            tvinit(void);
 
 // uart.c
@@ -20,6 +20,12 @@ exec(char *path, char **argv)
   pde_t *pgdir, *oldpgdir;
   struct proc *curproc = myproc();
 
+#ifdef CS333_P3
+  // Other threads still run on the pgdir exec would free.
+  if(curproc->isthread || curproc->threads.head)
+    return -1;
+#endif
+
   begin_op();
 
   if((ip = namei(path)) == 0){
@@ -31,6 +31,7 @@
 #define ICRHI   (0x0310/4)   // Interrupt Command [63:32]
 #define TIMER   (0x0320/4)   // Local Vector Table 0 (TIMER)
   #define X1         0x0000000B   // divide counts by 1
+  #define ONESHOT    0x00000000   // One-shot
   #define PERIODIC   0x00020000   // Periodic
 #define PCINT   (0x0340/4)   // Performance Counter LVT
 #define LINT0   (0x0350/4)   // Local Vector Table 1 (LINT0)
@@ -41,6 +42,12 @@
 #define TCCR    (0x0390/4)   // Timer Current Count
 #define TDCR    (0x03E0/4)   // Timer Divide Configuration
 
+#ifdef PDX_XV6
+#define TICR_TICK 1000000   // Timer counts per clock tick
+#else
+#define TICR_TICK 10000000
+#endif // PDX_XV6
+
 volatile uint *lapic;  // Initialized in mp.c
 
 static void
@@ -65,11 +72,7 @@ lapicinit(void)
   // TICR would be calibrated using an external time source.
   lapicw(TDCR, X1);
   lapicw(TIMER, PERIODIC | (T_IRQ0 + IRQ_TIMER));
-#ifdef PDX_XV6
-  lapicw(TICR, 1000000);
-#else
-  lapicw(TICR, 10000000);
-#endif // PDX_XV6
+  lapicw(TICR, TICR_TICK);
 
   // Disable logical interrupt lines.
   lapicw(LINT0, MASKED);
@@ -108,6 +111,45 @@ lapicid(void)
   return lapic[ID] >> 24;
 }
 
+#ifdef CS333_P3
+// Stop the periodic timer and interrupt once, n ticks from now.
+// Used by idle cpus so that they are not woken every tick.
+void
+lapiconeshot(uint n)
+{
+  if(!lapic)
+    return;
+  if(n > 0xFFFFFFFF / TICR_TICK)
+    n = 0xFFFFFFFF / TICR_TICK;
+  lapicw(TIMER, ONESHOT | (T_IRQ0 + IRQ_TIMER));
+  lapicw(TICR, n * TICR_TICK);
+}
+
+// Return to one interrupt per tick.
+void
+lapicperiodic(void)
+{
+  if(!lapic)
+    return;
+  lapicw(TIMER, PERIODIC | (T_IRQ0 + IRQ_TIMER));
+  lapicw(TICR, TICR_TICK);
+}
+#endif // CS333_P3
+
+#ifdef CS333_P4
+// Interrupt the cpu whose APIC id is apicid with the given vector.
+void
+lapicipi(uchar apicid, int vector)
+{
+  if(!lapic)
+    return;
+  lapicw(ICRHI, apicid<<24);
+  lapicw(ICRLO, FIXED | ASSERT | vector);
+  while(lapic[ICRLO] & DELIVS)
+    ;
+}
+#endif // CS333_P4
+
 // Acknowledge interrupt.
 void
 lapiceoi(void)
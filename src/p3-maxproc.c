@@ -0,0 +1,98 @@
+#ifdef CS333_P3
+#include "types.h"
+#include "user.h"
+
+// Tests the setmaxproc() cap on live procs.  Children block on a pipe
+// so they stay live until the parent is done forking.
+
+#define EXTRA 3
+
+static int fds[2];
+static int nkids;
+
+// Fork a child that waits for the pipe to close.  Returns fork's result
+// in the parent.
+static int
+spawn(void)
+{
+  char c;
+  int pid = fork();
+
+  if(pid == 0)
+  {
+    close(fds[1]);
+    read(fds[0], &c, 1);
+    exit();
+  }
+  if(pid > 0)
+    nkids++;
+  return pid;
+}
+
+static void
+reap(void)
+{
+  close(fds[1]);
+  while(nkids > 0 && wait() > 0)
+    nkids--;
+  close(fds[0]);
+}
+
+void
+testInvalid(void)
+{
+  printf(1, "Testing invalid setmaxproc caps\n");
+  if(check(setmaxproc(0) == -1, "cap of 0 accepted") &&
+     check(setmaxproc(-1) == -1, "negative cap accepted") &&
+     check(setmaxproc(1 << 30) == -1, "huge cap accepted"))
+  {
+    printf(1, "**** TEST PASSES ****\n\n");
+  }
+}
+
+void
+testCap(void)
+{
+  int old, cap, i, ok;
+
+  printf(1, "Testing that fork stops at the cap\n");
+  if(pipe(fds) < 0)
+  {
+    printf(2, "pipe failed\n**** TEST FAILED ****\n\n");
+    return;
+  }
+  old = setmaxproc(1);
+  ok = check(old > 0, "setmaxproc failed") &&
+       check(spawn() == -1, "fork succeeded under a cap of 1");
+  // Raise the cap one at a time until a fork fits; the live count is
+  // then exactly cap.
+  for(cap = 2; ok && cap <= old; cap++)
+  {
+    setmaxproc(cap);
+    if(spawn() > 0)
+      break;
+  }
+  ok = ok && check(cap <= old, "no fork fit under the old cap") &&
+       check(spawn() == -1, "fork succeeded at the cap");
+  if(ok)
+  {
+    setmaxproc(cap + EXTRA);
+    for(i = 0; i < EXTRA; i++)
+      ok = ok && check(spawn() > 0, "fork failed below the cap");
+    ok = ok && check(spawn() == -1, "fork succeeded past the raised cap");
+  }
+  if(old > 0)
+    setmaxproc(old);
+  reap();
+  if(ok)
+    printf(1, "**** TEST PASSES ****\n\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+  testInvalid();
+  testCap();
+  exit();
+}
+#endif // CS333_P3
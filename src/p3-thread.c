@@ -0,0 +1,135 @@
+#ifdef CS333_P3
+#include "types.h"
+#include "user.h"
+
+// Tests the clone and join system calls.
+
+#define PGSIZE 4096
+#define NTHREAD 4
+
+static volatile int slot[NTHREAD];
+static char * volatile grown;
+static volatile int letgo;
+
+// Page-aligned stack; the malloc'd block is leaked on purpose since the
+// test is short-lived.
+static void*
+stackalloc(void)
+{
+  char *p = malloc(2 * PGSIZE);
+
+  return (void*)(((uint)p + PGSIZE - 1) & ~(PGSIZE - 1));
+}
+
+static void
+worker(void *arg)
+{
+  int i = (int)arg;
+
+  slot[i] = i + 1;
+  exit();
+}
+
+static void
+waiter(void *arg)
+{
+  while(!letgo)
+    ;
+  exit();
+}
+
+static void
+grower(void *arg)
+{
+  grown = sbrk(PGSIZE);
+  grown[0] = 'x';
+  exit();
+}
+
+void
+testShared(void)
+{
+  void *stacks[NTHREAD], *stack;
+  int i, n, ok = 1;
+
+  printf(1, "Testing that %d threads share memory with the caller\n", NTHREAD);
+  for(i = 0; i < NTHREAD; i++)
+  {
+    stacks[i] = stackalloc();
+    if(!check(clone(worker, (void*)i, stacks[i]) > 0, "clone failed"))
+      return;
+  }
+  for(n = 0; n < NTHREAD; n++)
+  {
+    if(!check(join(&stack) > 0, "join failed"))
+      return;
+    for(i = 0; i < NTHREAD && stacks[i] != stack; i++)
+      ;
+    ok = ok && i < NTHREAD;
+  }
+  for(i = 0; i < NTHREAD; i++)
+    ok = ok && slot[i] == i + 1;
+  if(check(ok, "thread writes or joined stacks are wrong") &&
+     check(join(&stack) == -1, "join without threads did not fail"))
+  {
+    printf(1, "**** TEST PASSES ****\n\n");
+  }
+}
+
+void
+testGrow(void)
+{
+  void *stack;
+
+  printf(1, "Testing that sbrk in a thread grows the shared space\n");
+  if(!check(clone(grower, 0, stackalloc()) > 0, "clone failed"))
+    return;
+  join(&stack);
+  if(check(grown != 0 && grown[0] == 'x', "grown memory not visible"))
+  {
+    printf(1, "**** TEST PASSES ****\n\n");
+  }
+}
+
+void
+testShrink(void)
+{
+  void *stack;
+  char *r;
+
+  printf(1, "Testing that sbrk cannot shrink memory a live thread shares\n");
+  letgo = 0;
+  if(!check(clone(waiter, 0, stackalloc()) > 0, "clone failed"))
+    return;
+  r = sbrk(-PGSIZE);
+  letgo = 1;
+  join(&stack);
+  if(check(r == (char*)-1, "shrink with a live thread succeeded"))
+  {
+    printf(1, "**** TEST PASSES ****\n\n");
+  }
+}
+
+void
+testInvalid(void)
+{
+  char *stack = stackalloc();
+
+  printf(1, "Testing invalid clone arguments\n");
+  if(check(clone(worker, 0, stack + 1) == -1, "unaligned stack accepted") &&
+     check(clone(worker, 0, (void*)0x7ffff000) == -1, "stack outside memory accepted"))
+  {
+    printf(1, "**** TEST PASSES ****\n\n");
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  testShared();
+  testGrow();
+  testShrink();
+  testInvalid();
+  exit();
+}
+#endif // CS333_P3
@@ -0,0 +1,82 @@
+#ifdef CS333_P3
+#include "types.h"
+#include "user.h"
+
+// Tests the yield and yield_to system calls with a thread pair that
+// takes turns.
+
+#define PGSIZE 4096
+#define ROUNDS 1000
+
+static volatile int turn, rounds;
+
+static void
+pong(void *arg)
+{
+  int partner = (int)arg;
+
+  while(rounds < ROUNDS)
+  {
+    if(turn == 1)
+    {
+      rounds++;
+      turn = 0;
+    }
+    yield_to(partner);
+  }
+  exit();
+}
+
+void
+testInvalid(void)
+{
+  printf(1, "Testing yield and invalid yield_to targets\n");
+  if(check(yield() == 0, "yield failed") &&
+     check(yield_to(getpid()) == -1, "yield_to self accepted") &&
+     check(yield_to(0) == -1, "yield_to pid 0 accepted") &&
+     check(yield_to(1) == -1, "yield_to a sleeping proc accepted"))
+  {
+    printf(1, "**** TEST PASSES ****\n\n");
+  }
+}
+
+void
+testPingPong(void)
+{
+  char *p = malloc(2 * PGSIZE);
+  void *stack = (void*)(((uint)p + PGSIZE - 1) & ~(PGSIZE - 1));
+  uint start, elapsed;
+  int pid;
+
+  printf(1, "Testing %d yield_to round trips between two threads\n", ROUNDS);
+  start = uptime();
+  pid = clone(pong, (void*)getpid(), stack);
+  if(!check(pid > 0, "clone failed"))
+    return;
+  while(rounds < ROUNDS)
+  {
+    if(turn == 0)
+      turn = 1;
+    yield_to(pid);
+  }
+  elapsed = uptime() - start;
+  printf(1, "%d round trips in %d ticks\n", ROUNDS, elapsed);
+  // Without a direct handoff each turn waits out the rest of a quantum,
+  // so a round trip costs at least a tick.
+  if(check(join(&stack) == pid, "join did not reap the partner") &&
+     check(rounds == ROUNDS, "partner lost a round") &&
+     check(elapsed < ROUNDS, "yield_to did not hand off the cpu"))
+  {
+    printf(1, "**** TEST PASSES ****\n\n");
+  }
+  free(p);
+}
+
+int
+main(int argc, char *argv[])
+{
+  testInvalid();
+  testPingPong();
+  exit();
+}
+#endif // CS333_P3
@@ -0,0 +1,87 @@
+#ifdef CS333_P4
+#include "types.h"
+#include "user.h"
+#include "param.h"
+#include "pdx.h"
+
+// Tests the setaffinity/getaffinity system calls.
+
+void
+testDefault(void)
+{
+  int mask;
+
+  printf(1, "Testing that a new process may run on every cpu\n");
+  mask = getaffinity(getpid());
+  if(check(mask > 0 && (mask & 1), "default affinity does not include cpu0"))
+  {
+    printf(1, "affinity mask is 0x%x\n**** TEST PASSES ****\n\n", mask);
+  }
+}
+
+void
+testPin(void)
+{
+  int pid, i;
+
+  printf(1, "Testing that a pinned process reads back its mask\n");
+  pid = getpid();
+  if(!check(setaffinity(pid, 1) == 0, "setaffinity(pid, 1) failed"))
+  {
+    return;
+  }
+  // Give the scheduler a few chances to move us.
+  for(i = 0; i < 10; i++)
+  {
+    sleep(1);
+  }
+  if(check(getaffinity(pid) == 1, "getaffinity did not return 1"))
+  {
+    printf(1, "**** TEST PASSES ****\n\n");
+  }
+  setaffinity(pid, ~0);
+}
+
+void
+testInherit(void)
+{
+  int pid, mask;
+
+  printf(1, "Testing that fork copies the affinity mask\n");
+  setaffinity(getpid(), 1);
+  pid = fork();
+  if(pid == 0)
+  {
+    mask = getaffinity(getpid());
+    if(check(mask == 1, "child did not inherit affinity"))
+    {
+      printf(1, "**** TEST PASSES ****\n\n");
+    }
+    exit();
+  }
+  wait();
+  setaffinity(getpid(), ~0);
+}
+
+void
+testInvalid(void)
+{
+  printf(1, "Testing invalid arguments\n");
+  if(check(setaffinity(getpid(), 0) == -1, "empty mask accepted") &&
+     check(setaffinity(-1, 1) == -1, "negative pid accepted") &&
+     check(getaffinity(-1) == -1, "getaffinity of negative pid succeeded"))
+  {
+    printf(1, "**** TEST PASSES ****\n\n");
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  testDefault();
+  testPin();
+  testInherit();
+  testInvalid();
+  exit();
+}
+#endif // CS333_P4
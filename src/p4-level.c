@@ -0,0 +1,115 @@
+#ifdef CS333_P4
+#include "types.h"
+#include "user.h"
+#include "param.h"
+#include "pdx.h"
+#include "uproc.h"
+
+// Tests the per-level quantum and budget tables and the boost given to
+// procs that wait on a device before their slice is up.
+
+void
+testTable(void)
+{
+  struct levelinfo old, li;
+
+  printf(1, "Testing setlevel and getlevel\n");
+  if(!check(getlevel(0, &old) == 0, "getlevel failed") ||
+     !check(old.quantum >= 1 && old.budget >= 1, "level 0 has an empty slice or budget"))
+    return;
+  li.quantum = old.quantum + 1;
+  li.budget = old.budget + 1;
+  if(!check(setlevel(0, &li) == 0, "setlevel failed"))
+    return;
+  getlevel(0, &li);
+  setlevel(0, &old);
+  if(!check(li.quantum == old.quantum + 1 && li.budget == old.budget + 1,
+            "setlevel did not change the table"))
+    return;
+  li.quantum = 0;
+  if(!check(setlevel(0, &li) == -1, "zero quantum accepted"))
+    return;
+  li.quantum = 1;
+  if(check(setlevel(MAXPRIO + 1, &li) == -1 && getlevel(-1, &li) == -1,
+           "bad level accepted"))
+  {
+    printf(1, "**** TEST PASSES ****\n\n");
+  }
+}
+
+void
+testDemote(void)
+{
+  int pid, prio;
+
+  printf(1, "Testing that a cpu-bound proc drops from MAXPRIO\n");
+  pid = fork();
+  if(pid == 0)
+  {
+    for(;;)
+      ;
+  }
+  setpriority(pid, MAXPRIO);
+  sleep(TPS);
+  prio = getpriority(pid);
+  kill(pid);
+  wait();
+  if(check(prio >= 0 && prio < MAXPRIO, "spinning proc was not demoted"))
+  {
+    printf(1, "**** TEST PASSES ****\n\n");
+  }
+}
+
+// Read files bigger than the buffer cache together, so some reads wait
+// on the disk.
+static void
+readfiles(void)
+{
+  static char *files[] = { "usertests", "sh", "p4-test", "p3-test", "ls", "grep" };
+  char buf[512];
+  int i, fd;
+
+  for(i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+  {
+    if((fd = open(files[i], 0)) < 0)
+      continue;
+    while(read(fd, buf, sizeof(buf)) > 0)
+      ;
+    close(fd);
+  }
+}
+
+void
+testBoost(void)
+{
+  int i, prio, pid = getpid();
+
+  printf(1, "Testing that timer sleeps do not boost and disk waits do\n");
+  setpriority(pid, 0);
+  for(i = 0; i < MAXPRIO; i++)
+    sleep(1);
+  prio = getpriority(pid);
+  // A promotion may land meanwhile and add one level.
+  if(!check(prio <= 1, "timer sleeps boosted the proc"))
+    return;
+  readfiles();
+  if(check(getpriority(pid) > prio, "disk waits did not boost the proc"))
+  {
+    printf(1, "**** TEST PASSES ****\n\n");
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  if(MAXPRIO == 0)
+  {
+    printf(1, "MAXPRIO is 0. Change MAXPRIO and try again\n");
+    exit();
+  }
+  testTable();
+  testDemote();
+  testBoost();
+  exit();
+}
+#endif // CS333_P4
@@ -0,0 +1,128 @@
+#ifdef CS333_P4
+#include "types.h"
+#include "user.h"
+#include "param.h"
+#include "pdx.h"
+
+// Tests the setsched system call and the real-time classes.
+
+void
+testInvalid(void)
+{
+  int pid = getpid();
+
+  printf(1, "Testing invalid setsched arguments\n");
+  if(check(setsched(pid, 3, 0, 0) == -1, "unknown class accepted") &&
+     check(setsched(pid, SCHED_EDF, 0, 0) == -1, "zero period accepted") &&
+     check(setsched(pid, SCHED_EDF, 10, 20) == -1, "runtime > period accepted") &&
+     check(setsched(pid, SCHED_EDF, MAXPERIOD + 1, 1) == -1, "period over MAXPERIOD accepted") &&
+     check(setsched(-1, SCHED_FIFO, 0, 0) == -1, "negative pid accepted"))
+  {
+    printf(1, "**** TEST PASSES ****\n\n");
+  }
+}
+
+// A FIFO proc keeps its priority however long it runs.
+void
+testNoDemotion(void)
+{
+  int pid = getpid();
+  int prio, i;
+  volatile int x = 0;
+
+  printf(1, "Testing that a FIFO process is never demoted\n");
+  setpriority(pid, MAXPRIO);
+  if(!check(setsched(pid, SCHED_FIFO, 0, 0) == 0, "setsched FIFO failed"))
+  {
+    return;
+  }
+  prio = getpriority(pid);
+  for(i = 0; i < 50000000; i++)
+  {
+    x++;
+  }
+  if(check(getpriority(pid) == prio, "FIFO process changed priority"))
+  {
+    printf(1, "**** TEST PASSES ****\n\n");
+  }
+  setsched(pid, SCHED_MLFQ, 0, 0);
+}
+
+// Reservations beyond every cpu's capacity are refused.
+void
+testAdmission(void)
+{
+  int pids[NCPU + 1];
+  int i, n, refused = 0;
+
+  printf(1, "Testing EDF admission control\n");
+  for(n = 0; n < NCPU + 1; n++)
+  {
+    pids[n] = fork();
+    if(pids[n] == 0)
+    {
+      sleep(1000);
+      exit();
+    }
+    if(setsched(pids[n], SCHED_EDF, 100, 90) == -1)
+    {
+      refused = 1;
+      n++;
+      break;
+    }
+  }
+  for(i = 0; i < n; i++)
+  {
+    kill(pids[i]);
+    wait();
+  }
+  if(check(refused, "over-subscribed EDF reservations were accepted"))
+  {
+    printf(1, "**** TEST PASSES ****\n\n");
+  }
+}
+
+// Admission is per cpu: two reservations that fit the machine but not
+// one cpu are refused when both procs may only run on cpu 0, and an
+// admitted proc may not be moved off its cpu.
+void
+testPerCpu(void)
+{
+  int pids[2];
+  int i, ok;
+
+  printf(1, "Testing per cpu EDF admission\n");
+  for(i = 0; i < 2; i++)
+  {
+    pids[i] = fork();
+    if(pids[i] == 0)
+    {
+      sleep(1000);
+      exit();
+    }
+    setaffinity(pids[i], 1);
+  }
+  ok = check(setsched(pids[0], SCHED_EDF, 100, 60) == 0, "first reservation refused") &&
+       check(setsched(pids[1], SCHED_EDF, 100, 60) == -1, "cpu 0 over-subscribed") &&
+       check(setaffinity(pids[0], 2) == -1, "EDF proc moved off its cpu");
+  for(i = 0; i < 2; i++)
+  {
+    kill(pids[i]);
+    wait();
+  }
+  if(ok)
+  {
+    printf(1, "**** TEST PASSES ****\n\n");
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  testInvalid();
+  testNoDemotion();
+  testAdmission();
+  testPerCpu();
+  exit();
+}
+#endif // CS333_P4
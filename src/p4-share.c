@@ -0,0 +1,48 @@
+#ifdef CS333_SHARE
+#include "types.h"
+#include "user.h"
+#include "param.h"
+#include "pdx.h"
+
+// Tests that the fair-share scheduler splits cpu time between uids
+// rather than between procs.  Uid 1 runs one spinning child and uid 2
+// runs three, all on cpu 0; with equal weights each uid should get half.
+
+#define NSPIN 4
+
+int
+main(int argc, char *argv[])
+{
+  int pids[NSPIN];
+  uint t[NSPIN];
+  int i;
+  uint t2;
+
+  printf(1, "Testing that one proc of uid 1 gets the cpu time of three of uid 2\n");
+  if(setuidweight(1, 0) != -1 || setuidweight(1, MAXUIDWEIGHT + 1) != -1 ||
+     setuidweight(-1, DEFAULT_UIDWEIGHT) != -1)
+  {
+    printf(2, "setuidweight accepted a bad argument\n**** TEST FAILED ****\n\n");
+    exit();
+  }
+  setuidweight(1, DEFAULT_UIDWEIGHT);
+  setuidweight(2, DEFAULT_UIDWEIGHT);
+  pids[0] = spinner(1);
+  for(i = 1; i < NSPIN; i++)
+    pids[i] = spinner(2);
+  spinrun(NSPIN, pids, t);
+  t2 = 0;
+  for(i = 1; i < NSPIN; i++)
+    t2 += t[i];
+  printf(1, "uid 1: %d ms, uid 2: %d ms\n", t[0], t2);
+  if(ratiook(t[0], t2, 7, 13))
+  {
+    printf(1, "**** TEST PASSES ****\n\n");
+  }
+  else
+  {
+    printf(2, "uid shares are not close to 1:1\n**** TEST FAILED ****\n\n");
+  }
+  exit();
+}
+#endif // CS333_SHARE
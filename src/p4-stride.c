@@ -0,0 +1,38 @@
+#ifdef CS333_STRIDE
+#include "types.h"
+#include "user.h"
+#include "param.h"
+#include "pdx.h"
+
+// Tests that the stride scheduler splits cpu time in proportion to
+// tickets.  Two spinning children share cpu 0 with a 3:1 allocation.
+
+int
+main(int argc, char *argv[])
+{
+  int pids[2];
+  uint t[2];
+
+  printf(1, "Testing that 300 tickets get three times the cpu of 100\n");
+  if(settickets(getpid(), 0) != -1 || gettickets(getpid()) != DEFAULT_TICKETS)
+  {
+    printf(2, "ticket syscalls misbehave\n**** TEST FAILED ****\n\n");
+    exit();
+  }
+  pids[0] = spinner(getuid());
+  settickets(pids[0], 300);
+  pids[1] = spinner(getuid());
+  settickets(pids[1], 100);
+  spinrun(2, pids, t);
+  printf(1, "300 tickets: %d ms, 100 tickets: %d ms\n", t[0], t[1]);
+  if(ratiook(t[0], t[1], 25, 35))
+  {
+    printf(1, "**** TEST PASSES ****\n\n");
+  }
+  else
+  {
+    printf(2, "share is not close to 3:1\n**** TEST FAILED ****\n\n");
+  }
+  exit();
+}
+#endif // CS333_STRIDE
@@ -0,0 +1,89 @@
+#ifdef CS333_P4
+#include "types.h"
+#include "user.h"
+#include "param.h"
+#include "pdx.h"
+
+// Tests that a woken proc preempts a lower priority one at once rather
+// than at the end of its slice.  A MAXPRIO proc sleeps for one tick at
+// a time on cpu 0 while a level 0 proc spins there.  Then tests that a
+// proc sleeping alone on cpu 1 wakes on time while every cpu is idle.
+
+#define NSLEEP 50
+
+void
+testPreempt(void)
+{
+  int pid, i;
+  uint start, elapsed;
+
+  printf(1, "Testing wakeup latency next to a spinning proc\n");
+  setaffinity(getpid(), 1);
+  pid = fork();
+  if(pid == 0)
+  {
+    for(;;)
+      ;
+  }
+  setaffinity(pid, 1);
+  setpriority(pid, 0);
+  setpriority(getpid(), MAXPRIO);
+  start = uptime();
+  for(i = 0; i < NSLEEP; i++)
+    sleep(1);
+  elapsed = uptime() - start;
+  kill(pid);
+  wait();
+  printf(1, "%d one tick sleeps took %d ticks\n", NSLEEP, elapsed);
+  if(elapsed < NSLEEP * 3)
+  {
+    printf(1, "**** TEST PASSES ****\n\n");
+  }
+  else
+  {
+    printf(2, "woken proc waited for the spinning one\n**** TEST FAILED ****\n\n");
+  }
+}
+
+void
+testIdleCpu(void)
+{
+  int i;
+  uint start, elapsed;
+
+  printf(1, "Testing wakeup latency on an idle cpu other than cpu 0\n");
+  if(setaffinity(getpid(), 2) < 0)
+  {
+    printf(1, "Only one cpu. Boot with CPUS=2 or more to run this test\n\n");
+    return;
+  }
+  sleep(1);  // move to cpu 1
+  start = uptime();
+  for(i = 0; i < NSLEEP; i++)
+    sleep(1);
+  elapsed = uptime() - start;
+  setaffinity(getpid(), ~0);
+  printf(1, "%d one tick sleeps took %d ticks\n", NSLEEP, elapsed);
+  if(elapsed < NSLEEP * 3)
+  {
+    printf(1, "**** TEST PASSES ****\n\n");
+  }
+  else
+  {
+    printf(2, "sleeper on an idle cpu overslept\n**** TEST FAILED ****\n\n");
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  if(MAXPRIO == 0)
+  {
+    printf(1, "MAXPRIO is 0. Change MAXPRIO and try again\n");
+    exit();
+  }
+  testPreempt();
+  testIdleCpu();
+  exit();
+}
+#endif // CS333_P4
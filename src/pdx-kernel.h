@@ -15,6 +15,30 @@ hlt()
   asm volatile("hlt");
 }
 
+// bsr() returns the index of the most significant set bit in a
+// non-zero word.  Used to find the highest non-empty ready list.
+static inline int
+bsr(uint word)
+{
+  int index;
+
+  asm volatile("bsrl %1, %0" : "=r" (index) : "rm" (word));
+  return index;
+}
+
+// div64() divides a 64-bit value by a 32-bit one with divl and returns
+// the low 32 bits of the quotient.  The kernel is not linked against
+// libgcc, so plain 64-bit division is unavailable.
+static inline uint
+div64(uint64 n, uint d)
+{
+  uint q, r;
+
+  r = (uint)(n >> 32) % d;  // keeps divl from overflowing
+  asm("divl %4" : "=a" (q), "=d" (r) : "0" ((uint)n), "1" (r), "rm" (d));
+  return q;
+}
+
 // atom_inc() necessary for removal of tickslock
 // other atomic ops added for completeness
 static inline void
@@ -18,8 +18,19 @@
 
 #define TPS 1000   // ticks-per-second
 #define SCHED_INTERVAL (TPS/100)  // see trap.c
+// Longest idle one-shot timer, in ticks.  P4 cpus are kicked by IPI
+// when work they could run is queued, so they may sleep longer; P3
+// cpus must wake to look at the shared RUNNABLE list.
+#ifdef CS333_P4
+#define TICKLESS_MAX TPS
+#else
+#define TICKLESS_MAX SCHED_INTERVAL
+#endif // CS333_P4
 
 #define NPROC  64  // maximum number of processes -- normally in param.h
+// P3 allocates procs on demand; cap them so fork cannot take every page.
+#define DEFAULT_MAXPROC 256
+#define MAXMAXPROC 4096  // largest cap setmaxproc() accepts
 
 #define min(a, b) ((a) < (b) ? (a) : (b))
 #define max(a, b) ((a) > (b) ? (a) : (b))
@@ -27,7 +38,25 @@
 #define UID 0
 #define MAXPRIO 6
 #define DEFAULTPRIO 0
-#define BUDGET 1000000
+#define BUDGET 1000000  // largest budget setlevel() accepts, in ticks
+// Default time slice and budget of each priority level, in ticks.
+// Slices grow toward level 0 so cpu-bound procs switch less often.
+#define DEFAULT_QUANTUM(level) (SCHED_INTERVAL * (MAXPRIO + 1 - (level)))
+#define DEFAULT_BUDGET(level) (10 * DEFAULT_QUANTUM(level))
+#define MAXQUANTUM TPS
 #define TICKS_TO_PROMOTE 3000
+// Scheduling classes for setsched().  Real-time procs (FIFO and EDF)
+// run before every MLFQ level and are never promoted or demoted.
+#define SCHED_MLFQ 0
+#define SCHED_FIFO 1
+#define SCHED_EDF  2  // earliest deadline first, with a period and runtime
+#define MAXPERIOD (60 * TPS)  // longest SCHED_EDF period, in ticks
+// Stride scheduler (SCHED=STRIDE) ticket allocations
+#define DEFAULT_TICKETS 100
+#define MAXTICKETS 10000
+// Fair-share scheduler (SCHED=SHARE) per-uid weights
+#define DEFAULT_UIDWEIGHT 100
+#define MAXUIDWEIGHT 10000
+#define NSHARE 16  // uids with a share of their own; the last entry pools the rest
 
 #endif  // PDX_INCLUDE
@@ -82,15 +82,20 @@ pipewrite(struct pipe *p, char *addr, int n)
   for(i = 0; i < n; i++){
     while(p->nwrite == p->nread + PIPESIZE){  //DOC: pipewrite-full
       if(p->readopen == 0 || myproc()->killed){
+        wakeup_one(&p->nwrite);  // pass on a wakeup meant for a writer
         release(&p->lock);
         return -1;
       }
-      wakeup(&p->nread);
+      wakeup_one(&p->nread);
       sleep(&p->nwrite, &p->lock);  //DOC: pipewrite-sleep
     }
     p->data[p->nwrite++ % PIPESIZE] = addr[i];
   }
-  wakeup(&p->nread);  //DOC: pipewrite-wakeup1
+  wakeup_one(&p->nread);  //DOC: pipewrite-wakeup1
+  // Waiters are woken one at a time, so let the next writer use any
+  // room that is left.
+  if(p->nwrite != p->nread + PIPESIZE)
+    wakeup_one(&p->nwrite);
   release(&p->lock);
   return n;
 }
@@ -103,6 +108,7 @@ piperead(struct pipe *p, char *addr, int n)
   acquire(&p->lock);
   while(p->nread == p->nwrite && p->writeopen){  //DOC: pipe-empty
     if(myproc()->killed){
+      wakeup_one(&p->nread);  // pass on a wakeup meant for a reader
       release(&p->lock);
       return -1;
     }
@@ -113,7 +119,10 @@ piperead(struct pipe *p, char *addr, int n)
       break;
     addr[i] = p->data[p->nread++ % PIPESIZE];
   }
-  wakeup(&p->nwrite);  //DOC: piperead-wakeup
+  wakeup_one(&p->nwrite);  //DOC: piperead-wakeup
+  // Likewise let the next reader have any data that is left.
+  if(p->nread != p->nwrite)
+    wakeup_one(&p->nread);
   release(&p->lock);
   return i;
 }
@@ -1,6 +1,10 @@
 #include "types.h"
 #include "stat.h"
 #include "user.h"
+#ifdef CS333_P4
+#include "pdx.h"
+#include "uproc.h"
+#endif // CS333_P4
 
 static void
 putc(int fd, char c)
@@ -83,3 +87,74 @@ printf(int fd, char *fmt, ...)
     }
   }
 }
+
+#ifdef PDX_XV6
+// Test helper: report msg and a failure banner on fd 2 if cond is false.
+// Returns cond so checks can be chained with &&.
+int
+check(int cond, char *msg)
+{
+  if(!cond)
+  {
+    printf(2, "%s\n**** TEST FAILED ****\n\n", msg);
+    return 0;
+  }
+  return 1;
+}
+#endif // PDX_XV6
+
+#ifdef CS333_P4
+// Scheduler share tests: spinning children on cpu 0 and the cpu time
+// each gets over SPINSECS seconds.
+#define SPINSECS 5
+
+// Fork a child that takes uid and spins on cpu 0 until killed.
+int
+spinner(uint uid)
+{
+  int pid = fork();
+
+  if(pid == 0)
+  {
+    setuid(uid);
+    for(;;)
+      ;
+  }
+  setaffinity(pid, 1);
+  return pid;
+}
+
+// Let the n spinners in pids run for SPINSECS seconds, store the cpu
+// ticks each got in ticks[], then kill and reap them.
+void
+spinrun(int n, int *pids, uint *ticks)
+{
+  struct uproc *table = malloc(DEFAULT_MAXPROC * sizeof(struct uproc));
+  int i, j, nproc;
+
+  sleep(SPINSECS * TPS);
+  nproc = getprocs(DEFAULT_MAXPROC, table);
+  for(i = 0; i < n; i++)
+  {
+    ticks[i] = 0;
+    for(j = 0; j < nproc; j++)
+    {
+      if(table[j].pid == pids[i])
+        ticks[i] = table[j].CPU_total_ticks;
+    }
+  }
+  for(i = 0; i < n; i++)
+  {
+    kill(pids[i]);
+    wait();
+  }
+  free(table);
+}
+
+// Is a:b between lo:10 and hi:10?
+int
+ratiook(uint a, uint b, int lo, int hi)
+{
+  return b > 0 && a * 10 >= b * lo && a * 10 <= b * hi;
+}
+#endif // CS333_P4
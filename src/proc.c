@@ -6,12 +6,66 @@
 #include "x86.h"
 #include "proc.h"
 #include "spinlock.h"
+#include "sleeplock.h"
+#ifdef CS333_P4
+#include "traps.h"
+#endif // CS333_P4
 #ifdef CS333_P2
 #include "uproc.h"
 #endif // CS333_P2
 #ifdef CS333_P3
 #define statecount NELEM(states)
+#define SLEEPQBITS 6
+#define NSLEEPQ (1 << SLEEPQBITS)  // sleep queue hash buckets
+#define PIDHASHBITS 10
+#define NPIDHASH (1 << PIDHASHBITS)  // pid hash buckets
+// Timer wheel geometry: tv1 has one slot per tick, each tvn level one
+// slot per TVR_SIZE << (TVN_BITS * level) ticks.
+#define TVR_BITS 8
+#define TVN_BITS 6
+#define TVR_SIZE (1 << TVR_BITS)
+#define TVN_SIZE (1 << TVN_BITS)
+#define TVR_MASK (TVR_SIZE - 1)
+#define TVN_MASK (TVN_SIZE - 1)
+#define TVN_LEVELS 3
+#define TV_MAXDELTA ((1 << (TVR_BITS + TVN_LEVELS * TVN_BITS)) - 1)
+// Load averages are sampled every LOAD_FREQ ticks and decay by
+// exp(-5s/1min), exp(-5s/5min) and exp(-5s/15min) in FSHIFT fixed point.
+#define FSHIFT 11
+#define FIXED_1 (1 << FSHIFT)
+#define LOAD_FREQ (5 * TPS)
+static uint loadexp[3] = { 1884, 2014, 2037 };
 #endif // CS333_P3
+#ifdef CS333_P4
+#define RT_MAXUTIL 950  // thousandths of each cpu EDF procs may reserve
+#endif // CS333_P4
+#ifdef CS333_FAIR
+// The CFS and stride builds replace the MLFQ levels with a tree of
+// procs ordered by virtual time (vruntime), so there is no promotion.
+#if !defined(CS333_P4)
+#error "CS333_CFS and CS333_STRIDE require CS333_P4"
+#endif
+#define PROMOTE 0
+#else
+#define PROMOTE MAXPRIO
+#endif // CS333_FAIR
+#ifdef CS333_CFS
+#define NICE_0_WEIGHT 1024
+#define FAIR_SLEEPCREDIT (SCHED_INTERVAL * (1000000 / TPS) / 2)  // usec
+#define FAIR_WAKEUPGRAN (SCHED_INTERVAL * (1000000 / TPS) / 2)   // usec
+#endif // CS333_CFS
+#ifdef CS333_STRIDE
+#define STRIDE1 (1 << 20)         // stride of a proc holding one ticket
+#define STRIDE_QUANTUM (SCHED_INTERVAL * (1000000 / TPS))  // usec
+#define FAIR_SLEEPCREDIT 0
+#define FAIR_WAKEUPGRAN (STRIDE1 / DEFAULT_TICKETS / 2)  // half a default quantum
+#endif // CS333_STRIDE
+#ifdef CS333_SHARE
+#if !defined(CS333_P4) || defined(CS333_FAIR)
+#error "CS333_SHARE requires CS333_P4 and the MLFQ"
+#endif
+#define SHARE_SLEEPCREDIT (SCHED_INTERVAL * (1000000 / TPS))  // pass, in usec
+#endif // CS333_SHARE
 
 static char *states[] = {
 [UNUSED]    "unused",
@@ -22,26 +76,43 @@ static char *states[] = {
 [ZOMBIE]    "zombie"
 };
 
-#ifdef CS333_P3
-// record with head and tail pointer for constant-time access to the beginning
-// and end of a linked list of struct procs.  use with stateListAdd() and
-// stateListRemove().
-struct ptrs {
-  struct proc* head;
-  struct proc* tail;
-};
-#endif // CS333_P3
-
 static struct {
   struct spinlock lock;
+  #ifdef CS333_P3
+  struct ptrs live;                       // every proc that is not UNUSED
+  int nlive;                              // procs on live
+  int maxproc;                            // allocproc() fails at this many
+  int nslab;                              // pages of procs from kalloc()
+  #else
   struct proc proc[NPROC];
+  #endif // CS333_P3
   #ifdef CS333_P3
   struct ptrs list[statecount];
+  struct ptrs sleepq[NSLEEPQ];
+  struct proc *pidhash[NPIDHASH];         // live pids, chained by hnext
+  struct ptrs tv1[TVR_SIZE];              // timer wheel, one slot per tick
+  struct ptrs tvn[TVN_LEVELS][TVN_SIZE];  // coarser levels cascade into tv1
+  uint timerBase;                         // next tick the wheel processes
+  uint loadavg[3];                        // fixed point, FSHIFT fraction bits
+  struct ptrs genlist;                    // every proc, by gen; see procTouch()
+  uint gen;                               // last generation handed out
+  uint nslot;                             // procs carved so far
+  // Read by every cpu on every tick without the lock, so kept off the
+  // lines that each state change writes.  No timer expires before
+  // timerNext.
+  volatile uint timerNext __attribute__((aligned(CACHELINE)));
+  volatile int ntimers;                   // procs in the wheel
+  volatile uint loadNext;                 // tick of the next load sample
   #endif // CS333_P3
   #ifdef CS333_P4
-  struct ptrs ready[MAXPRIO+1];
   uint PromoteAtTime;
+  uint promoteEpoch;  // number of promotions so far, applied lazily
+  struct levelinfo levels[MAXPRIO+1];
   #endif // CS333_P4
+  #ifdef CS333_SHARE
+  struct ushare shares[NSHARE];
+  uint64 sharefloor;  // pass of the last uid served; see shareWake()
+  #endif // CS333_SHARE
 } ptable;
 
 // list management function prototypes
@@ -49,9 +120,68 @@ static struct {
 static void initProcessLists(void);
 static void initFreeList(void);
 static void stateListAdd(struct ptrs*, struct proc*);
+static void stateListAddHead(struct ptrs*, struct proc*);
 static int  stateListRemove(struct ptrs*, struct proc* p);
 static void assertState(struct proc*, enum procstate, const char *, int);
+static uint sleepqHash(void*);
+static void sleepqAdd(struct proc*);
+static void loadUpdate(void);
+static void procTouch(struct proc*);
+static void wakeProc(struct proc*);
+static void sleepqRemove(struct proc*);
+static void timerAdd(struct proc*);
+static void timerRemove(struct proc*);
+static void timerRun(uint);
+static void idletimer(struct cpu*);
+static uint cpuCharge(struct proc*);
+static void kidAdd(struct ptrs*, struct proc*);
+static void kidRemove(struct ptrs*, struct proc*);
+static void kidSplice(struct ptrs*, struct ptrs*, struct proc*);
+static void pidhashAdd(struct proc*);
+static void pidhashRemove(struct proc*);
+static struct proc* pidLookup(int);
+static void liveAdd(struct proc*);
+static void liveRemove(struct proc*);
+static int  procSlabGrow(void);
 #endif // CS333_P3
+#ifdef CS333_P4
+static void readyAdd(struct cpu*, struct proc*);
+static void readyInsert(struct cpu*, struct proc*, int);
+static int  rtBefore(struct proc*, struct proc*);
+static void reschedKick(struct cpu*, struct proc*);
+static void budgetCharge(struct proc*);
+static void unboost(struct proc*);
+static int  basePriority(struct proc*);
+static int  levelBudget(int);
+static uint sliceTicks(struct proc*);
+static void ioBoost(struct proc*);
+static void rtRelease(struct proc*);
+#ifdef CS333_FAIR
+static void fairAdd(struct cpu*, struct proc*);
+#endif // CS333_FAIR
+#ifdef CS333_SHARE
+static struct ushare* shareLookup(uint);
+static void shareSet(struct proc*, struct ushare*);
+static void shareWake(struct ushare*);
+static void shareQueueAdd(struct cpu*, struct proc*);
+static void shareQueueRemove(struct cpu*, struct proc*);
+static void shareShift(struct cpu*);
+static void shareServe(struct ushare*);
+static struct proc* shareTake(struct cpu*);
+static struct proc* shareStealable(struct cpu*, int, uint);
+#endif // CS333_SHARE
+#ifdef CS333_CFS
+static uint cfsWeight(struct proc*);
+#endif // CS333_CFS
+static int  readyRemove(struct proc*);
+static struct proc* readyTake(struct cpu*);
+static struct proc* readySelect(struct cpu*);
+static int  readyPending(void);
+static struct cpu* readyPlace(struct cpu*, struct proc*);
+static void readySync(struct cpu*);
+static void promoteProc(struct proc*);
+static int  promotedPriority(struct proc*);
+#endif // CS333_P4
 
 static struct proc *initproc;
 
@@ -64,6 +194,12 @@ void
 pinit(void)
 {
   initlock(&ptable.lock, "ptable");
+  #ifdef CS333_P4
+  for(int i = 0; i <= MAXPRIO; i++){
+    ptable.levels[i].quantum = DEFAULT_QUANTUM(i);
+    ptable.levels[i].budget = DEFAULT_BUDGET(i);
+  }
+  #endif // CS333_P4
 }
 
 // Must be called with interrupts disabled
@@ -73,36 +209,31 @@ cpuid() {
 }
 
 // Must be called with interrupts disabled to avoid the caller being
-// rescheduled between reading lapicid and running through the loop.
+// rescheduled onto another cpu while it uses the result.  seginit()
+// bases each cpu's %gs segment at its struct cpu, whose self field
+// comes first.  The asm is volatile since the answer changes across
+// swtch().
 struct cpu*
 mycpu(void)
 {
-  int apicid, i;
+  struct cpu *c;
 
   if(readeflags()&FL_IF)
     panic("mycpu called with interrupts enabled\n");
 
-  apicid = lapicid();
-  // APIC IDs are not guaranteed to be contiguous. Maybe we should have
-  // a reverse map, or reserve a register to store &cpus[i].
-  for (i = 0; i < ncpu; ++i) {
-    if (cpus[i].apicid == apicid) {
-      return &cpus[i];
-    }
-  }
-  panic("unknown apicid\n");
+  asm volatile("movl %%gs:0, %0" : "=r" (c));
+  return c;
 }
 
-// Disable interrupts so that we are not rescheduled
-// while reading proc from the cpu structure
+// The proc running on this cpu.  One load through %gs cannot be split
+// by a reschedule, and the answer stays right if the caller moves to
+// another cpu afterwards, so interrupts need not be disabled.
 struct proc*
 myproc(void) {
-  struct cpu *c;
   struct proc *p;
-  pushcli();
-  c = mycpu();
-  p = c->proc;
-  popcli();
+
+  asm volatile("movl %%gs:%c1, %0"
+               : "=r" (p) : "i" (__builtin_offsetof(struct cpu, proc)));
   return p;
 }
 
@@ -119,8 +250,16 @@ allocproc(void)
   acquire(&ptable.lock);
   int found = 0;
   #ifdef CS333_P3
+  // The UNUSED list caches procs freed by wait(); carve a new page of
+  // procs only when it is empty.
+  // Procs come from kalloc() on demand, so cap them before a fork
+  // loop takes every page.
+  if(ptable.list[UNUSED].head == NULL && ptable.nlive < ptable.maxproc)
+  {
+    procSlabGrow();
+  }
   p = ptable.list[UNUSED].head;
-  if(p)
+  if(p && ptable.nlive < ptable.maxproc)
   {
     found = 1;
   }
@@ -150,12 +289,18 @@ allocproc(void)
   stateListAdd(&ptable.list[EMBRYO], p);
   #endif // CS333_P3
   p->pid = nextpid++;
+  #ifdef CS333_P3
+  pidhashAdd(p);
+  liveAdd(p);
+  #endif // CS333_P3
   release(&ptable.lock);
 
   // Allocate kernel stack.
   if((p->kstack = kalloc()) == 0){
     #ifdef CS333_P3
     acquire(&ptable.lock);
+    pidhashRemove(p);
+    liveRemove(p);
     if(stateListRemove(&ptable.list[EMBRYO], p) == -1)
     {
       panic("Process Not Found In EMBRYO List!");
@@ -195,10 +340,41 @@ allocproc(void)
   p->cpu_ticks_total = 0;
   p->cpu_ticks_in = 0;
   #endif // CS333_P2
+  #ifdef CS333_P3
+  p->cpu_tsc_in = 0;
+  p->cpu_usec_total = 0;
+  #endif // CS333_P3
+  #ifdef CS333_P3
+  p->kids.head = p->kids.tail = NULL;
+  p->zombies.head = p->zombies.tail = NULL;
+  p->snext = p->sprev = NULL;
+  p->isthread = 0;
+  p->ustack = 0;
+  p->threads.head = p->threads.tail = NULL;
+  p->tzombies.head = p->tzombies.tail = NULL;
+  #endif // CS333_P3
   //Set Default Priority to value defined in pdx.h, used DEFAULTPRIO to control the default priority for testing promotion and demotion.
   #ifdef CS333_P4
   p->priority = DEFAULTPRIO;
-  p->budget = BUDGET;
+  p->budget = levelBudget(DEFAULTPRIO);
+  p->rq = NULL;
+  p->epoch = ptable.promoteEpoch;
+  p->lastcpu = NULL;
+  p->affinity = ~0;
+  p->sched = SCHED_MLFQ;
+  p->rtutil = 0;
+  p->rtcpu = NULL;
+  p->boosted = 0;
+  p->waitlock = NULL;
+  p->held = NULL;
+  p->iowait = 0;
+  #ifdef CS333_FAIR
+  p->vruntime = 0;
+  #endif // CS333_FAIR
+  #ifdef CS333_STRIDE
+  p->tickets = DEFAULT_TICKETS;
+  p->stride = STRIDE1 / DEFAULT_TICKETS;
+  #endif // CS333_STRIDE
   #endif // CS333_P4
   return p;
 }
@@ -211,9 +387,13 @@ userinit(void)
   acquire(&ptable.lock);
   initProcessLists();
   initFreeList();
+  ptable.loadNext = ticks + LOAD_FREQ;
   #ifdef CS333_P4
   ptable.PromoteAtTime = ticks + TICKS_TO_PROMOTE;
   #endif // CS333_P4
+  #ifdef CS333_SHARE
+  ptable.shares[NSHARE-1].weight = DEFAULT_UIDWEIGHT;
+  #endif // CS333_SHARE
   release(&ptable.lock);
   #endif // CS333_P3
 
@@ -255,15 +435,54 @@ userinit(void)
   }
   assertState(p, EMBRYO, __FUNCTION__, __LINE__);
   #endif // CS333_P3
+  #ifdef CS333_SHARE
+  shareSet(p, shareLookup(p->uid));
+  #endif // CS333_SHARE
   p->state = RUNNABLE;
   #if defined (CS333_P4)
-  stateListAdd(&ptable.ready[p->priority], p);
+  readyAdd(mycpu(), p);
   #elif defined (CS333_P3)
   stateListAdd(&ptable.list[RUNNABLE], p);
   #endif // CS333_P4
   release(&ptable.lock);
 }
 
+#ifdef CS333_P3
+// growproc() for a proc whose pgdir is shared by threads.  ptable.lock
+// serializes concurrent growers and lets every member see the new size.
+// Shrinking is refused while any thread is alive: another cpu could
+// still reach the freed pages through its TLB, or be in a syscall
+// that has already checked a user buffer in them.
+static int
+growgroup(struct proc *curproc, int n)
+{
+  struct proc *leader = curproc->isthread ? curproc->parent : curproc;
+  struct proc *p;
+  uint sz;
+
+  acquire(&ptable.lock);
+  sz = leader->sz;
+  if(n > 0){
+    if((sz = allocuvm(leader->pgdir, sz, sz + n)) == 0){
+      release(&ptable.lock);
+      return -1;
+    }
+  } else if(n < 0){
+    if(leader->threads.head ||
+       (sz = deallocuvm(leader->pgdir, sz, sz + n)) == 0){
+      release(&ptable.lock);
+      return -1;
+    }
+  }
+  leader->sz = sz;
+  for(p = leader->threads.head; p; p = p->snext)
+    p->sz = sz;
+  release(&ptable.lock);
+  switchuvm(curproc);
+  return 0;
+}
+#endif // CS333_P3
+
 // Grow current process's memory by n bytes.
 // Return 0 on success, -1 on failure.
 int
@@ -272,6 +491,10 @@ growproc(int n)
   uint sz;
   struct proc *curproc = myproc();
 
+  #ifdef CS333_P3
+  if(curproc->isthread || curproc->threads.head)
+    return growgroup(curproc, n);
+  #endif // CS333_P3
   sz = curproc->sz;
   if(n > 0){
     if((sz = allocuvm(curproc->pgdir, sz, sz + n)) == 0)
@@ -285,14 +508,47 @@ growproc(int n)
   return 0;
 }
 
+// Copy the open files, cwd, name and scheduling attributes that a
+// new proc or thread takes from its creator.
+static void
+inherit(struct proc *np, struct proc *curproc)
+{
+  int i;
+
+  for(i = 0; i < NOFILE; i++)
+    if(curproc->ofile[i])
+      np->ofile[i] = filedup(curproc->ofile[i]);
+  np->cwd = idup(curproc->cwd);
+
+  safestrcpy(np->name, curproc->name, sizeof(curproc->name));
+
+  #ifdef CS333_P2
+  np->uid = curproc->uid;
+  np->gid = curproc->gid;
+  #endif // CS333_P2
+  #ifdef CS333_P4
+  np->affinity = curproc->affinity;
+  // FIFO is inherited; an EDF reservation is not, so EDF children
+  // start in the MLFQ.
+  if(curproc->sched == SCHED_FIFO){
+    np->sched = SCHED_FIFO;
+  }
+  #endif // CS333_P4
+  #ifdef CS333_FAIR
+  np->vruntime = curproc->vruntime;
+  #endif // CS333_FAIR
+  #ifdef CS333_STRIDE
+  np->tickets = curproc->tickets;
+  np->stride = curproc->stride;
+  #endif // CS333_STRIDE
+}
+
 // Create a new process copying p as the parent.
 // Sets up stack to return as if from system call.
 // Caller must set state of returned proc to RUNNABLE.
 int
 fork(void)
 {
-  int i;
-
   uint pid;
   struct proc *np;
   struct proc *curproc = myproc();
@@ -318,6 +574,8 @@ fork(void)
     np->state = UNUSED;
     #ifdef CS333_P3
     acquire(&ptable.lock);
+    pidhashRemove(np);
+    liveRemove(np);
     stateListAdd(&ptable.list[UNUSED], np);
     release(&ptable.lock);
     #endif // CS333_P3
@@ -330,23 +588,19 @@ fork(void)
   // Clear %eax so that fork returns 0 in the child.
   np->tf->eax = 0;
 
-  for(i = 0; i < NOFILE; i++)
-    if(curproc->ofile[i])
-      np->ofile[i] = filedup(curproc->ofile[i]);
-  np->cwd = idup(curproc->cwd);
-
-  safestrcpy(np->name, curproc->name, sizeof(curproc->name));
-
+  inherit(np, curproc);
   pid = np->pid;
-  #ifdef CS333_P2
-  np->uid = curproc->uid;
-  np->gid = curproc->gid;
-  #endif // CS333_P2
 
   acquire(&ptable.lock);
+  #ifdef CS333_P3
+  kidAdd(&curproc->kids, np);
+  #endif // CS333_P3
+  #ifdef CS333_SHARE
+  shareSet(np, curproc->share);
+  #endif // CS333_SHARE
   np->state = RUNNABLE;
   #if defined (CS333_P4)
-  stateListAdd(&ptable.ready[np->priority], np);
+  readyAdd(mycpu(), np);
   #elif defined (CS333_P3)
   stateListAdd(&ptable.list[RUNNABLE], np);
   #endif // CS333_P4
@@ -355,6 +609,165 @@ fork(void)
   return pid;
 }
 
+#ifdef CS333_P3
+// Create a thread that shares the caller's address space and starts in
+// fn(arg) on the user stack page at stack.  Threads belong to the group
+// leader, the proc that was not itself made by clone().  Returns the
+// new thread's pid.
+int
+clone(void (*fn)(void*), void *arg, void *stack)
+{
+  uint pid, sp, ustack[2];
+  struct proc *np;
+  struct proc *curproc = myproc();
+  struct proc *leader = curproc->isthread ? curproc->parent : curproc;
+
+  if((uint)stack % PGSIZE != 0 || (uint)stack + PGSIZE > curproc->sz)
+    return -1;
+
+  // Fake return pc so that fn traps if it returns instead of exiting.
+  sp = (uint)stack + PGSIZE - sizeof ustack;
+  ustack[0] = 0xffffffff;
+  ustack[1] = (uint)arg;
+  if(copyout(curproc->pgdir, sp, ustack, sizeof ustack) < 0)
+    return -1;
+
+  if((np = allocproc()) == 0){
+    return -1;
+  }
+  acquire(&ptable.lock);
+  if(stateListRemove(&ptable.list[EMBRYO], np) == -1)
+  {
+    panic("Process Not Found In EMBRYO List!");
+  }
+  assertState(np, EMBRYO, __FUNCTION__, __LINE__);
+  release(&ptable.lock);
+
+  np->pgdir = curproc->pgdir;
+  np->sz = curproc->sz;
+  np->parent = leader;
+  np->isthread = 1;
+  np->ustack = stack;
+  *np->tf = *curproc->tf;
+  np->tf->eip = (uint)fn;
+  np->tf->esp = sp;
+
+  inherit(np, curproc);
+  pid = np->pid;
+
+  acquire(&ptable.lock);
+  kidAdd(&leader->threads, np);
+  #ifdef CS333_SHARE
+  shareSet(np, curproc->share);
+  #endif // CS333_SHARE
+  // An exiting leader has already killed every thread it knows of.
+  if(curproc->killed)
+    np->killed = 1;
+  np->state = RUNNABLE;
+  #ifdef CS333_P4
+  readyAdd(mycpu(), np);
+  #else
+  stateListAdd(&ptable.list[RUNNABLE], np);
+  #endif // CS333_P4
+  release(&ptable.lock);
+
+  return pid;
+}
+
+// Free a ZOMBIE proc taken off the list it was reaped from and return
+// its pid.  A thread's pgdir belongs to its leader and is left alone.
+static uint
+procReap(struct ptrs *list, struct proc *p)
+{
+  uint pid = p->pid;
+
+  kfree(p->kstack);
+  p->kstack = 0;
+  if(!p->isthread)
+    freevm(p->pgdir);
+  pidhashRemove(p);
+  liveRemove(p);
+  p->pid = 0;
+  p->parent = 0;
+  p->name[0] = 0;
+  p->killed = 0;
+  p->isthread = 0;
+  #ifdef CS333_SHARE
+  shareSet(p, NULL);
+  #endif // CS333_SHARE
+  kidRemove(list, p);
+  if(stateListRemove(&ptable.list[ZOMBIE], p) == -1)
+  {
+    panic("Process Not Found In ZOMBIE List!");
+  }
+  assertState(p, ZOMBIE, __FUNCTION__, __LINE__);
+  p->state = UNUSED;
+  stateListAdd(&ptable.list[UNUSED], p);
+  return pid;
+}
+
+// Mark p killed and make it runnable if it sleeps.
+// Caller must hold ptable.lock.
+static void
+killProc(struct proc *p)
+{
+  p->killed = 1;
+  if(p->state == SLEEPING)
+    wakeProc(p);
+}
+
+// A leader leaving with threads still running would free the pgdir
+// from under them, so kill the threads and reap each one first.
+static void
+threadsExit(struct proc *curproc)
+{
+  struct proc *p;
+
+  acquire(&ptable.lock);
+  for(p = curproc->threads.head; p; p = p->snext)
+    killProc(p);
+  while(curproc->threads.head)
+    sleep(curproc, &ptable.lock);
+  while((p = curproc->tzombies.head) != NULL)
+    procReap(&curproc->tzombies, p);
+  release(&ptable.lock);
+}
+
+// Wait for a thread of the caller's group to exit, store the stack it
+// was given to clone() in *stack and return its pid.  Return -1 if no
+// other thread is left to wait for.
+int
+join(void **stack)
+{
+  struct proc *p;
+  struct proc *curproc = myproc();
+  struct proc *leader = curproc->isthread ? curproc->parent : curproc;
+  char *ustack;
+  uint pid;
+
+  acquire(&ptable.lock);
+  for(;;){
+    p = leader->tzombies.head;
+    if(p){
+      ustack = p->ustack;
+      pid = procReap(&leader->tzombies, p);
+      release(&ptable.lock);
+      *stack = ustack;
+      return pid;
+    }
+
+    p = leader->threads.head;
+    if(p == NULL || (p == curproc && p->snext == NULL) || curproc->killed){
+      release(&ptable.lock);
+      return -1;
+    }
+
+    // Exiting threads wake their leader.
+    sleep(leader, &ptable.lock);
+  }
+}
+#endif // CS333_P3
+
 // Exit the current process.  Does not return.
 // An exited process remains in the zombie state
 // until its parent calls wait() to find out it exited.
@@ -363,12 +776,14 @@ void
 exit(void)
 {
   struct proc *curproc = myproc();
-  struct proc *p;
   int fd;
 
   if(curproc == initproc)
     panic("init exiting");
 
+  if(curproc->threads.head || curproc->tzombies.head)
+    threadsExit(curproc);
+
   // Close all open files.
   for(fd = 0; fd < NOFILE; fd++){
     if(curproc->ofile[fd]){
@@ -388,36 +803,19 @@ exit(void)
   wakeup1(curproc->parent);
   
   // Pass abandoned children to init.
-  for(int i = 1; i < statecount; ++i){
-    if(i != RUNNABLE)
-    {
-      p = ptable.list[i].head;
-      while(p)
-      {
-        if(p->parent == curproc){
-
-          p->parent = initproc;
-          if(p->state == ZOMBIE)
-          {
-            wakeup1(initproc);
-          }
-        }
-        p = p->next;
-      }
-    }
+  kidSplice(&initproc->kids, &curproc->kids, initproc);
+  if(curproc->zombies.head){
+    kidSplice(&initproc->zombies, &curproc->zombies, initproc);
+    wakeup1(initproc);
   }
-
-  for(int i = MAXPRIO; i > -1; --i)
-  {
-    p = ptable.ready[i].head;
-    while(p){
-      if(p->parent == curproc){
-        p->parent = initproc;
-      }
-      p = p->next;
-    }
+  if(curproc->isthread){
+    kidRemove(&curproc->parent->threads, curproc);
+    kidAdd(&curproc->parent->tzombies, curproc);
+  } else {
+    kidRemove(&curproc->parent->kids, curproc);
+    kidAdd(&curproc->parent->zombies, curproc);
   }
- 
+
   // Jump into the scheduler, never to return.
   if(stateListRemove(&ptable.list[RUNNING], curproc) == -1)
   {
@@ -426,15 +824,8 @@ exit(void)
   assertState(curproc, RUNNING, __FUNCTION__, __LINE__);
 
   // Here to Complete Transition Budget Math
-  if(MAXPRIO){
-    curproc->budget = curproc->budget - (ticks - curproc->cpu_ticks_in);
-    if(curproc->budget <= 0){
-      if(curproc->priority > 0){
-        curproc->priority -= 1;
-      }
-      curproc->budget = BUDGET;
-    }
-  }
+  budgetCharge(curproc);
+  rtRelease(curproc);
 
   curproc->state = ZOMBIE;
   stateListAdd(&ptable.list[ZOMBIE], curproc);
@@ -451,12 +842,14 @@ void
 exit(void)
 {
   struct proc *curproc = myproc();
-  struct proc *p;
   int fd;
 
   if(curproc == initproc)
     panic("init exiting");
 
+  if(curproc->threads.head || curproc->tzombies.head)
+    threadsExit(curproc);
+
   // Close all open files.
   for(fd = 0; fd < NOFILE; fd++){
     if(curproc->ofile[fd]){
@@ -476,18 +869,17 @@ exit(void)
   wakeup1(curproc->parent);
 
   // Pass abandoned children to init.
-  for(int i = 1; i < statecount; ++i){
-    p = ptable.list[i].head;
-    while(p){  
-      if(p->parent == curproc){
-        p->parent = initproc;
-        if(p->state == ZOMBIE)
-        {
-          wakeup1(initproc);
-        }
-      }
-      p = p->next;
-    }
+  kidSplice(&initproc->kids, &curproc->kids, initproc);
+  if(curproc->zombies.head){
+    kidSplice(&initproc->zombies, &curproc->zombies, initproc);
+    wakeup1(initproc);
+  }
+  if(curproc->isthread){
+    kidRemove(&curproc->parent->threads, curproc);
+    kidAdd(&curproc->parent->tzombies, curproc);
+  } else {
+    kidRemove(&curproc->parent->kids, curproc);
+    kidAdd(&curproc->parent->zombies, curproc);
   }
 
   // Jump into the scheduler, never to return.
@@ -555,125 +947,27 @@ exit(void)
 
 // Wait for a child process to exit and return its pid.
 // Return -1 if this process has no children.
-#if defined (CS333_P4)
+#if defined (CS333_P3)
 int
 wait(void)
 {
   struct proc *p;
-  int havekids;
   uint pid;
   struct proc *curproc = myproc();
 
   acquire(&ptable.lock);
   for(;;){
-    havekids = 0;
-    // Look for Kids in State Lists
-    for(int i = 1; i < statecount; ++i)
-    {
-      if(i != RUNNABLE)
-      {
-        p = ptable.list[i].head;
-        while(p)
-        {
-          if(p->parent == curproc)
-          {
-            havekids = 1;
-            if(p->state == ZOMBIE){
-              // Found one.
-              pid = p->pid;
-              kfree(p->kstack);
-              p->kstack = 0;
-              freevm(p->pgdir);
-              p->pid = 0;
-              p->parent = 0;
-              p->name[0] = 0;
-              p->killed = 0;
-              if(stateListRemove(&ptable.list[ZOMBIE], p) == -1)
-              {
-                panic("Process Not Found In ZOMBIE List!");
-              }
-              assertState(p, ZOMBIE, __FUNCTION__, __LINE__);
-              p->state = UNUSED;
-              stateListAdd(&ptable.list[UNUSED], p);
-              release(&ptable.lock);
-              return pid;
-            }
-          }
-          p = p->next;
-        }
-      }
-    }
-
-    // Look for Kids in Ready Lists
-    for(int i = MAXPRIO; i > -1; --i)
-    {
-      p = ptable.ready[i].head;
-      while(p){
-        if(p->parent == curproc){
-          havekids = 1;
-        }
-        p = p->next;
-      }
-    }
-
-    // No point waiting if we don't have any children.
-    if(!havekids || curproc->killed){
+    // Exited children wait on curproc->zombies, so no scan is needed.
+    p = curproc->zombies.head;
+    if(p){
+      // Found one.
+      pid = procReap(&curproc->zombies, p);
       release(&ptable.lock);
-      return -1;
+      return pid;
     }
 
-    // Wait for children to exit.  (See wakeup1 call in proc_exit.)
-    sleep(curproc, &ptable.lock);  //DOC: wait-sleep
-  }
-}
-
-#elif defined(CS333_P3)
-int
-wait(void)
-{
-  struct proc *p;
-  int havekids;
-  uint pid;
-  struct proc *curproc = myproc();
-
-  acquire(&ptable.lock);
-  for(;;){
-    // Scan through table looking for exited children.
-    havekids = 0;
-    for(int i = 1; i < statecount; ++i)
-    {
-      p = ptable.list[i].head;
-      while(p)
-      {
-        if(p->parent == curproc)
-        {
-          havekids = 1;
-          if(p->state == ZOMBIE){
-          // Found one.
-            pid = p->pid;
-            kfree(p->kstack);
-            p->kstack = 0;
-            freevm(p->pgdir);
-            p->pid = 0;
-            p->parent = 0;
-            p->name[0] = 0;
-            p->killed = 0;
-            if(stateListRemove(&ptable.list[ZOMBIE], p) == -1)
-            {
-              panic("Process Not Found In ZOMBIE List!");
-            }
-            assertState(p, ZOMBIE, __FUNCTION__, __LINE__);
-            p->state = UNUSED;
-            stateListAdd(&ptable.list[UNUSED], p);
-            release(&ptable.lock);
-            return pid;
-          }
-        }
-        p = p->next;
-      }
-    }
     // No point waiting if we don't have any children.
-    if(!havekids || curproc->killed){
+    if(curproc->kids.head == NULL || curproc->killed){
       release(&ptable.lock);
       return -1;
     }
@@ -740,83 +1034,45 @@ void
 scheduler(void)
 {
   struct proc *p;
-  struct proc *save;
+  struct proc *handoff;
   struct cpu *c = mycpu();
   c->proc = 0;
   #ifdef PDX_XV6
   int idle;  // for checking if processor is idle
+  uint64 t;
   #endif // PDX_XV6
+  c->starttsc = rdtsc();
 
   for(;;){
     // Enable interrupts on this processor.
     sti();
 
+    // Any reschedule request is answered by this pass.  xchg orders
+    // the clear before the ready counts are read below.
+    xchg(&c->resched, 0);
     #ifdef PDX_XV6
     idle = 1;  // assume idle unless we schedule a process
     #endif // PDX_XV6
 
-    acquire(&ptable.lock);
-    // PROMOTION has MAXPRIO as field to turn on and off ready lists
-    // For the case MAXPRIO = 0
-    if(ticks >= ptable.PromoteAtTime && MAXPRIO)
-    {
-      //Promotes On SLEEPING List
-      p = ptable.list[SLEEPING].head;
-      while(p){
-        if(p->priority < MAXPRIO) // Prevents prio over MAXPRIO or promoting procs at MAXPRIO
-        {
-          p->priority += 1;
-          p->budget = BUDGET;
-        }
-        p = p->next;
-      }
-
-      //Promotes On RUNNING List
-      p = ptable.list[RUNNING].head;
-      while(p){
-        if(p->priority < MAXPRIO) // Prevents prio over MAXPRIO or promoting procs at MAXPRIO
-        {
-          p->priority += 1;
-          p->budget = BUDGET;
-        }
-        p = p->next;
-      }
-
-      // Promotes On Ready (RUNNABLE) Lists
-      for(int i = MAXPRIO; i > -1; --i)
+    // Peek at the ready counts without the lock so that idle cpus do not
+    // contend for ptable.lock when there is nothing to run or promote.
+    if(readyPending() || (PROMOTE && ticks >= ptable.PromoteAtTime)){
+      acquire(&ptable.lock);
+      // PROMOTION has MAXPRIO as field to turn on and off ready lists
+      // For the case MAXPRIO = 0.  Starting a new epoch is all the work
+      // done here; readySync() and promoteProc() apply it lazily.
+      if(PROMOTE && ticks >= ptable.PromoteAtTime)
       {
-        p = ptable.ready[i].head;
-        while(p){
-          // Saves next process in ready list
-          save = p->next;
-          if(p->priority < MAXPRIO) // Prevents access to ready list MAXPRIO
-          {
-            // Removes From Priority List, Sets Promoted Priority,
-            // and adds back to ready list with the budget.
-            if(stateListRemove(&ptable.ready[p->priority], p) == -1)
-            {
-              panic("Process Not Found in Ready Lists!");
-            }
-            assertState(p, RUNNABLE, __FUNCTION__, __LINE__); // Checks if state is still correctA
-            p->priority += 1;
-            p->budget = BUDGET;
-            stateListAdd(&ptable.ready[p->priority], p);
-          }
-          // readies next process
-          p = save;
-        }
+        ptable.promoteEpoch++;
+        ptable.PromoteAtTime = ticks + TICKS_TO_PROMOTE;
       }
-      ptable.PromoteAtTime = ticks + TICKS_TO_PROMOTE;
-    }
-    release(&ptable.lock);
-    
-    // Loop through ready lists starting at MAXPRIO looking for non empty ready list,
-    // If found select the head of the list to run
-    acquire(&ptable.lock);
-    for(int i = MAXPRIO; i > -1; --i)
-    {
-      p = ptable.ready[i].head; // Selects Head
-      if(p){ // Checks if head exists
+
+      // Take the head of this cpu's highest non empty ready list,
+      // or steal from the busiest peer if this cpu has nothing queued.
+      // A yieldto() target only gets what is left of its caller's slice.
+      handoff = c->handoff;
+      p = readySelect(c);
+      if(p){
         // Switch to chosen process.  It is the process's job
         // to release ptable.lock and then reacquire it
         // before jumping back to us.
@@ -824,17 +1080,12 @@ scheduler(void)
         idle = 0;  // not idle this timeslice
         #endif // PDX_XV6
         c->proc = p;
+        p->lastcpu = c;
+        c->sliceend = p == handoff ? c->handoffend : ticks + sliceTicks(p);
         switchuvm(p);
-        if(stateListRemove(&ptable.ready[p->priority], p) == -1)
-        {
-          if(p->priority != i)
-          {
-            panic("Process Not Found in Correct Ready List!");
-          }
-          else
-          {
-            panic("Process Not Found In Ready Lists!");
-          }
+        if(c->tickless){
+          lapicperiodic();
+          c->tickless = 0;
         }
         assertState(p, RUNNABLE, __FUNCTION__, __LINE__);
         p->state = RUNNING;
@@ -842,22 +1093,32 @@ scheduler(void)
         #ifdef CS333_P2
         p->cpu_ticks_in = ticks;
         #endif // CS333_P2
+        #ifdef CS333_P3
+        p->cpu_tsc_in = rdtsc();
+        #endif // CS333_P3
         swtch(&(c->scheduler), p->context);
         switchkvm();
 
         // Process is done running for now.
         // It should have changed its p->state before coming back.
         c->proc = 0;
-        break; // Used to prevent scheduler from scheduling another
-        // process due to for loop being used.
       }
+      release(&ptable.lock);
     }
-    release(&ptable.lock);
     #ifdef PDX_XV6
-    // if idle, wait for next interrupt
+    // If idle, wait for the next interrupt.  A reschedule request
+    // that came after the clear above skips the hlt; one that comes
+    // after cli() is held pending and ends it at once, since sti()
+    // only takes effect after the following instruction.
     if (idle) {
-      sti();
-      hlt();
+      cli();
+      if(!c->resched){
+        idletimer(c);
+        t = rdtsc();
+        sti();
+        hlt();
+        c->idletsc += rdtsc() - t;
+      }
     }
     #endif // PDX_XV6
   }
@@ -872,7 +1133,9 @@ scheduler(void)
   c->proc = 0;
   #ifdef PDX_XV6
   int idle;  // for checking if processor is idle
+  uint64 t;
   #endif // PDX_XV6
+  c->starttsc = rdtsc();
 
   for(;;){
     // Enable interrupts on this processor.
@@ -893,6 +1156,10 @@ scheduler(void)
       #endif // PDX_XV6
       c->proc = p;
       switchuvm(p);
+      if(c->tickless){
+        lapicperiodic();
+        c->tickless = 0;
+      }
       if(stateListRemove(&ptable.list[RUNNABLE], p) == -1)
       {
         panic("Process Not Found In RUNNABLE List!");
@@ -903,6 +1170,9 @@ scheduler(void)
       #ifdef CS333_P2
       p->cpu_ticks_in = ticks;
       #endif // CS333_P2
+      #ifdef CS333_P3
+      p->cpu_tsc_in = rdtsc();
+      #endif // CS333_P3
       swtch(&(c->scheduler), p->context);
       switchkvm();
 
@@ -914,9 +1184,15 @@ scheduler(void)
     release(&ptable.lock);
     #ifdef PDX_XV6
     // if idle, wait for next interrupt
+    // sti() takes effect after the next instruction, so an interrupt
+    // cannot slip in between it and hlt().
     if (idle) {
+      cli();
+      idletimer(c);
+      t = rdtsc();
       sti();
       hlt();
+      c->idletsc += rdtsc() - t;
     }
     #endif // PDX_XV6
   }
@@ -958,6 +1234,9 @@ scheduler(void)
       #ifdef CS333_P2
       p->cpu_ticks_in = ticks;
       #endif // CS333_P2
+      #ifdef CS333_P3
+      p->cpu_tsc_in = rdtsc();
+      #endif // CS333_P3
       swtch(&(c->scheduler), p->context);
       switchkvm();
 
@@ -998,9 +1277,11 @@ sched(void)
     panic("sched running");
   if(readeflags()&FL_IF)
     panic("sched interruptible");
-  #ifdef CS333_P2
+  #if defined(CS333_P3)
+  cpuCharge(p);
+  #elif defined(CS333_P2)
   p->cpu_ticks_total += (ticks - p->cpu_ticks_in);
-  #endif // CS333_P2
+  #endif // CS333_P3
   intena = mycpu()->intena;
   swtch(&p->context, mycpu()->scheduler);
   mycpu()->intena = intena;
@@ -1021,21 +1302,55 @@ yield(void)
   assertState(curproc, RUNNING, __FUNCTION__, __LINE__);
   curproc->state = RUNNABLE;
   
-  // Add to Ready List
-  if(MAXPRIO)
+  // Add to Ready List.  A preempted FIFO proc keeps its place at the
+  // front of its class.
+  budgetCharge(curproc);
+  readyInsert(mycpu(), curproc, curproc->sched == SCHED_FIFO);
+  sched();
+  release(&ptable.lock);
+}
+
+// Give up the CPU voluntarily.  Unlike yield() the caller goes to the
+// back of its class.  If pid names another runnable proc that may run
+// on this cpu, it is queued here and runs next in the caller's place,
+// for the rest of the caller's slice.
+// Return -1 without yielding if pid is not 0 and names no runnable proc.
+int
+yieldto(int pid)
+{
+  struct proc *curproc = myproc();
+  struct proc *p = NULL;
+  struct cpu *c = mycpu();
+
+  acquire(&ptable.lock);
+  if(pid != 0){
+    p = pidLookup(pid);
+    if(p == NULL || p == curproc || p->state != RUNNABLE){
+      release(&ptable.lock);
+      return -1;
+    }
+  }
+  if(stateListRemove(&ptable.list[RUNNING], curproc) == -1)
   {
-    curproc->budget = curproc->budget - (ticks - curproc->cpu_ticks_in);
-    if(curproc->budget <= 0){
-      if(curproc->priority > 0)
-      {
-        curproc->priority -= 1;
+    panic("Process Not Found In RUNNING List!");
+  }
+  assertState(curproc, RUNNING, __FUNCTION__, __LINE__);
+  curproc->state = RUNNABLE;
+  budgetCharge(curproc);
+  readyInsert(c, curproc, 0);
+  if(p && (p->affinity & (1 << (c - cpus)))){
+    if(p->rq != c){
+      if(readyRemove(p) == -1){
+        panic("Process Not Found In Ready Lists!");
       }
-      curproc->budget = BUDGET; // Adjust budget if value
+      readyInsert(c, p, 1);
     }
+    c->handoff = p;
+    c->handoffend = c->sliceend;
   }
-  stateListAdd(&ptable.ready[curproc->priority], curproc);
   sched();
   release(&ptable.lock);
+  return 0;
 }
 
 #elif defined(CS333_P3)
@@ -1056,6 +1371,41 @@ yield(void)
   release(&ptable.lock);
 }
 
+// Give up the CPU voluntarily.  If pid names another runnable proc it
+// moves to the head of the RUNNABLE list so the scheduler runs it next.
+// Return -1 without yielding if pid is not 0 and names no runnable proc.
+int
+yieldto(int pid)
+{
+  struct proc *curproc = myproc();
+  struct ptrs *ready = &ptable.list[RUNNABLE];
+  struct proc *p = NULL;
+
+  acquire(&ptable.lock);
+  if(pid != 0){
+    p = pidLookup(pid);
+    if(p == NULL || p == curproc || p->state != RUNNABLE){
+      release(&ptable.lock);
+      return -1;
+    }
+    if(stateListRemove(ready, p) == -1)
+    {
+      panic("Process Not Found In RUNNABLE List!");
+    }
+    stateListAddHead(ready, p);
+  }
+  if(stateListRemove(&ptable.list[RUNNING], curproc) == -1)
+  {
+    panic("Process Not Found In RUNNING List!");
+  }
+  assertState(curproc, RUNNING, __FUNCTION__, __LINE__);
+  curproc->state = RUNNABLE;
+  stateListAdd(ready, curproc);
+  sched();
+  release(&ptable.lock);
+  return 0;
+}
+
 #else
 void
 yield(void)
@@ -1120,21 +1470,12 @@ sleep(void *chan, struct spinlock *lk)
   }
   assertState(p, RUNNING, __FUNCTION__, __LINE__);
   #ifdef CS333_P4
-  if(MAXPRIO)
-  {
-    p->budget = p->budget - (ticks - p->cpu_ticks_in);
-    if(p->budget <= 0)
-    {
-      if(p->priority > 0)
-      {
-        p->priority -= 1;
-      }
-      p->budget = BUDGET;
-    }
-  }
+  budgetCharge(p);
+  ioBoost(p);
   #endif // CS333_P4
   p->state = SLEEPING;
   stateListAdd(&ptable.list[SLEEPING], p);
+  sleepqAdd(p);
 
   sched();
 
@@ -1184,47 +1525,68 @@ sleep(void *chan, struct spinlock *lk)
 }
 #endif // CS333_P3
 
-// Wake up all processes sleeping on chan.
+// sleep() for a wait on a device: the disk or console input.  Only
+// these waits earn the P4 I/O boost; see ioBoost().
+void
+sleepio(void *chan, struct spinlock *lk)
+{
+  #ifdef CS333_P4
+  myproc()->iowait = 1;
+  #endif // CS333_P4
+  sleep(chan, lk);
+}
+
+#if defined(CS333_P3)
+// Make the sleeping proc p runnable.
 // The ptable lock must be held.
-#if defined(CS333_P4)
 static void
-wakeup1(void *chan)
+wakeProc(struct proc *p)
 {
-  struct proc *p = ptable.list[SLEEPING].head;
-  while(p){
-    if(p->state == SLEEPING && p->chan == chan){
-      if(stateListRemove(&ptable.list[SLEEPING], p) == -1)
-      {
-        panic("Proccess Not Found In SLEEPING List!");
-      }
-      assertState(p, SLEEPING, __FUNCTION__, __LINE__);
-      p->state = RUNNABLE;
-      stateListAdd(&ptable.ready[p->priority], p);
-    }
-    p = p->next;
+  assertState(p, SLEEPING, __FUNCTION__, __LINE__);
+  sleepqRemove(p);
+  if(stateListRemove(&ptable.list[SLEEPING], p) == -1)
+  {
+    panic("Proccess Not Found In SLEEPING List!");
   }
+  p->state = RUNNABLE;
+  #ifdef CS333_P4
+  readyAdd(mycpu(), p);
+  #else
+  stateListAdd(&ptable.list[RUNNABLE], p);
+  #endif // CS333_P4
 }
 
-#elif defined(CS333_P3)
+// Wake up the processes sleeping on chan: all of them, or with one set
+// just the one that has waited longest, since sleepqAdd() queues in
+// arrival order.  The ptable lock must be held.
+// Only the sleep queue bucket for chan is searched.
 static void
-wakeup1(void *chan)
+wakeupChan(void *chan, int one)
 {
-  struct proc *p = ptable.list[SLEEPING].head;
+  struct proc *p = ptable.sleepq[sleepqHash(chan)].head;
+  struct proc *next;
   while(p){
-    if(p->state == SLEEPING && p->chan == chan){
-      if(stateListRemove(&ptable.list[SLEEPING], p) == -1)
-      {
-        panic("Proccess Not Found In SLEEPING List!");
-      }
-      assertState(p, SLEEPING, __FUNCTION__, __LINE__);
-      p->state = RUNNABLE;
-      stateListAdd(&ptable.list[RUNNABLE], p);
+    next = p->qnext;
+    if(p->chan == chan){
+      wakeProc(p);
+      if(one)
+        return;
     }
-    p = p->next;
+    p = next;
   }
 }
 
+// Wake up all processes sleeping on chan.
+// The ptable lock must be held.
+static void
+wakeup1(void *chan)
+{
+  wakeupChan(chan, 0);
+}
+
 #else
+// Wake up all processes sleeping on chan.
+// The ptable lock must be held.
 static void
 wakeup1(void *chan)
 {
@@ -1234,7 +1596,7 @@ wakeup1(void *chan)
     if(p->state == SLEEPING && p->chan == chan)
       p->state = RUNNABLE;
 }
-#endif // CS333_P4
+#endif // CS333_P3
 
 // Wake up all processes sleeping on chan.
 void
@@ -1245,91 +1607,188 @@ wakeup(void *chan)
   release(&ptable.lock);
 }
 
-// Kill the process with the given pid.
-// Process won't exit until it returns
-// to user space (see trap in trap.c).
-#if defined(CS333_P4)
+// Wake up the process that has slept longest on chan, for channels
+// where only one waiter can make progress.  Without the sleep queues
+// there is no arrival order to go by, so every waiter is woken.
+void
+wakeup_one(void *chan)
+{
+  acquire(&ptable.lock);
+  #ifdef CS333_P3
+  wakeupChan(chan, 1);
+  #else
+  wakeup1(chan);
+  #endif // CS333_P3
+  release(&ptable.lock);
+}
+
+#ifdef CS333_P3
+// Sleep for n ticks.  The proc is filed in the timer wheel under its
+// deadline and sleeps on its own channel, so only the tick on which
+// the deadline falls wakes it.  Returns -1 if killed.
 int
-kill(int pid)
+sleepticks(uint n)
 {
-  struct proc *p;
-  
+  struct proc *p = myproc();
+  uint ticks0;
+
   acquire(&ptable.lock);
-  for(int i = 1; i < statecount; ++i)
-  {
-    if(i != RUNNABLE)
-    {
-      p = ptable.list[i].head;
-      while(p)
-      {
-        if(p->pid == pid) {
-          p->killed = 1;
-          if(p->state == SLEEPING){
-            if(stateListRemove(&ptable.list[SLEEPING], p) == -1)
-            {
-              panic("Process Not Found in Sleeping List!");
-            }
-            assertState(p, SLEEPING, __FUNCTION__, __LINE__);
-            p->state = RUNNABLE;
-            stateListAdd(&ptable.ready[p->priority], p);
-          }
-          release(&ptable.lock);
-          return 0;
-        }
-        p = p->next;
-      }
+  ticks0 = ticks;
+  while(ticks - ticks0 < n){
+    if(p->killed){
+      release(&ptable.lock);
+      return -1;
     }
+    p->wakeat = ticks0 + n;
+    timerAdd(p);
+    sleep(&p->wakeat, &ptable.lock);
+    // Woken before the deadline, e.g. by kill().
+    if(p->tslot)
+      timerRemove(p);
   }
+  release(&ptable.lock);
+  return 0;
+}
 
-  for(int i = MAXPRIO; i > -1; --i)
-  {
-    p = ptable.ready[i].head;
-    while(p)
-    {
-      if(p->pid == pid)
-      {
-        p->killed = 1;
-        release(&ptable.lock);
-        return 0;
-      }
-      p = p->next;
-    }
+// Put an idle cpu's LAPIC timer in one-shot mode so hlt() is not
+// interrupted every tick.  Every idle cpu wakes for the next timer
+// wheel or promotion deadline: the proc that armed a timer may have
+// slept on any cpu, and the others may already be halted with later
+// deadlines.  No cpu sleeps longer than TICKLESS_MAX, so an idle cpu
+// still notices work it can steal from busy peers.  A
+// one-shot that has not fired is only moved earlier: re-arming it
+// from now on every device interrupt or IPI could put it off forever.
+static void
+idletimer(struct cpu *c)
+{
+  int delay = TICKLESS_MAX;
+  uint deadline;
+
+  if(!clockcalibrated())
+    return;
+  if(ptable.ntimers > 0)
+    delay = min(delay, (int)(ptable.timerNext - ticks));
+  #ifdef CS333_P4
+  if(PROMOTE)
+    delay = min(delay, (int)(ptable.PromoteAtTime - ticks));
+  #endif // CS333_P4
+  delay = max(delay, 1);
+  deadline = ticks + delay;
+  if(c->tickless && c->armed && (int)(deadline - c->idledeadline) >= 0)
+    return;
+  lapiconeshot(delay);
+  c->tickless = 1;
+  c->armed = 1;
+  c->idledeadline = deadline;
+}
+
+// Called on every clock tick after ticks is advanced.  Ticks on which
+// no timer expires return without touching ptable.lock.
+void
+timertick(void)
+{
+  int timers = ptable.ntimers > 0 && (int)(ticks - ptable.timerNext) >= 0;
+
+  if(!timers && (int)(ticks - ptable.loadNext) < 0)
+    return;
+  acquire(&ptable.lock);
+  if(timers)
+    timerRun(ticks);
+  loadUpdate();
+  release(&ptable.lock);
+}
+
+// Fold the number of running and runnable procs into the load averages
+// once for every LOAD_FREQ ticks that have passed.  A cpu that slept
+// tickless through several samples catches up here with the current
+// count.  Caller must hold ptable.lock.
+static void
+loadUpdate(void)
+{
+  struct proc *p;
+  uint n = 0;
+  int i;
+
+  if((int)(ticks - ptable.loadNext) < 0)
+    return;
+  for(p = ptable.list[RUNNING].head; p; p = p->next)
+    n++;
+  #ifdef CS333_P4
+  for(i = 0; i < ncpu; i++)
+    n += cpus[i].nready;
+  #else
+  for(p = ptable.list[RUNNABLE].head; p; p = p->next)
+    n++;
+  #endif // CS333_P4
+  n *= FIXED_1;
+  while((int)(ticks - ptable.loadNext) >= 0){
+    for(i = 0; i < 3; i++)
+      ptable.loadavg[i] = ((uint64)ptable.loadavg[i] * loadexp[i] +
+                           (uint64)n * (FIXED_1 - loadexp[i])) >> FSHIFT;
+    ptable.loadNext += LOAD_FREQ;
+    #ifdef CS333_SHARE
+    for(i = 0; i < NSHARE; i++)
+      ptable.shares[i].usage >>= 1;
+    #endif // CS333_SHARE
   }
+}
+
+// Read a 64-bit counter that another cpu adds to.  The two halves are
+// loaded separately, so read until two loads agree.
+static uint64
+tscRead(volatile uint64 *v)
+{
+  uint64 x;
+
+  do{
+    x = *v;
+  }while(x != *v);
+  return x;
+}
+
+// Report the load averages and each cpu's busy and idle time.
+int
+getload(struct loadinfo *li)
+{
+  uint64 now;
+  uint total;
+  int i;
+
+  acquire(&ptable.lock);
+  loadUpdate();
+  for(i = 0; i < 3; i++)
+    li->avg[i] = (ptable.loadavg[i] * 100 + FIXED_1 / 2) >> FSHIFT;
   release(&ptable.lock);
-  return -1;
+
+  li->ncpu = ncpu;
+  now = rdtsc();
+  for(i = 0; i < ncpu; i++){
+    total = tscticks(now - cpus[i].starttsc);
+    li->idle[i] = tscticks(tscRead(&cpus[i].idletsc));
+    li->busy[i] = total > li->idle[i] ? total - li->idle[i] : 0;
+  }
+  return 0;
 }
+#endif // CS333_P3
 
-#elif defined(CS333_P3)
+// Kill the process with the given pid.
+// Process won't exit until it returns
+// to user space (see trap in trap.c).
+#if defined(CS333_P3)
 int
 kill(int pid)
 {
   struct proc *p;
 
   acquire(&ptable.lock);
-  for(int i = 1; i < statecount; ++i)
-  {
-    p = ptable.list[i].head;
-    while(p)
-    {
-      if(p->pid == pid) {
-        p->killed = 1;
-        if(p->state == SLEEPING){
-          if(stateListRemove(&ptable.list[SLEEPING], p) == -1)
-          {
-            panic("Process Not Found in Sleeping List!");
-          }
-          assertState(p, SLEEPING, __FUNCTION__, __LINE__);
-          p->state = RUNNABLE;
-          stateListAdd(&ptable.list[RUNNABLE], p);
-        }
-        release(&ptable.lock);
-        return 0;
-      }
-      p = p->next;
-    }
+  p = pidLookup(pid);
+  if(p == NULL){
+    release(&ptable.lock);
+    return -1;
   }
+  killProc(p);
   release(&ptable.lock);
-  return -1;
+  return 0;
 }
 
 #else
@@ -1384,7 +1843,7 @@ procdumpP4(struct proc *p, char *state_string)
   {
     ppid = p->parent->pid;
   }
-  cprintf("%d\t\t%d\t%d\t%d\t", p->uid, p->gid, ppid, p->priority);
+  cprintf("%d\t\t%d\t%d\t%d\t", p->uid, p->gid, ppid, promotedPriority(p));
   if(mill < 10)
   {
     cprintf("%d.00%d\t", sec, mill);
@@ -1574,7 +2033,11 @@ procdump(void)
 
   cprintf(HEADER);  // not conditionally compiled as must work in all project states
 
+  #ifdef CS333_P3
+  for(p = ptable.live.head; p; p = p->lnext){
+  #else
   for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+  #endif // CS333_P3
     if(p->state == UNUSED)
       continue;
     if(p->state >= 0 && p->state < NELEM(states) && states[p->state])
@@ -1614,12 +2077,14 @@ void runnabledump()
   cprintf("Ready List Processes:\n");
   acquire(&ptable.lock);
   struct proc *p;
-  for(int i = MAXPRIO; i > -1; --i)
+  for(struct cpu *c = cpus; c < &cpus[ncpu]; c++)
   {
-    p = ptable.ready[i].head;
-    cprintf("%d: ", i);
+    cprintf("cpu%d:\n", c - cpus);
+    readySync(c);
+    p = c->rt.head;
+    cprintf("rt: ");
     while(p){
-      cprintf("(%d, %d)", p->pid, p->budget);
+      cprintf("(%d, %d)", p->pid, p->deadline);
       if(p->next != NULL)
       {
         cprintf("->");
@@ -1627,6 +2092,33 @@ void runnabledump()
       p = p->next;
     }
     cprintf("\n");
+    #ifdef CS333_FAIR
+    cprintf("fair: ");
+    for(struct rbnode *n = c->fairq.first; n; n = rbnext(n)){
+      p = rbentry(n, struct proc, rbnode);
+      cprintf("(%d, %d)", p->pid, (uint)(p->vruntime - c->minvr));
+      if(rbnext(n) != NULL)
+      {
+        cprintf("->");
+      }
+    }
+    cprintf("\n");
+    #else
+    for(int i = MAXPRIO; i > -1; --i)
+    {
+      p = c->ready[i].head;
+      cprintf("%d: ", i);
+      while(p){
+        cprintf("(%d, %d)", p->pid, p->budget);
+        if(p->next != NULL)
+        {
+          cprintf("->");
+        }
+        p = p->next;
+      }
+      cprintf("\n");
+    }
+    #endif // CS333_FAIR
   }
   release(&ptable.lock);
   cprintf("\n");
@@ -1733,19 +2225,40 @@ void zombiedump()
 static void
 stateListAdd(struct ptrs* list, struct proc* p)
 {
+  procTouch(p);
   if((*list).head == NULL){
     (*list).head = p;
     (*list).tail = p;
     p->next = NULL;
+    p->prev = NULL;
   } else{
     ((*list).tail)->next = p;
+    p->prev = (*list).tail;
     (*list).tail = ((*list).tail)->next;
     ((*list).tail)->next = NULL;
   }
 }
+
+// stateListAdd() at the front of the list, for a proc that is to run
+// next.
+static void
+stateListAddHead(struct ptrs* list, struct proc* p)
+{
+  procTouch(p);
+  p->prev = NULL;
+  p->next = (*list).head;
+  if((*list).head == NULL){
+    (*list).tail = p;
+  } else{
+    ((*list).head)->prev = p;
+  }
+  (*list).head = p;
+}
 #endif
 
 #if defined(CS333_P3)
+// Constant time: p->prev locates the predecessor, so no walk is needed.
+// The neighbour checks catch a proc that is not on this list.
 static int
 stateListRemove(struct ptrs* list, struct proc* p)
 {
@@ -1753,84 +2266,1139 @@ stateListRemove(struct ptrs* list, struct proc* p)
     return -1;
   }
 
-  struct proc* current = (*list).head;
-  struct proc* previous = 0;
-
-  if(current == p){
-    (*list).head = ((*list).head)->next;
-    // prevent tail remaining assigned when we've removed the only item
-    // on the list
-    if((*list).tail == p){
-      (*list).tail = NULL;
-    }
-    return 0;
-  }
-
-  while(current){
-    if(current == p){
-      break;
-    }
-
-    previous = current;
-    current = current->next;
-  }
-
   // Process not found. return error
-  if(current == NULL){
+  if((p->prev == NULL && (*list).head != p) ||
+     (p->prev != NULL && p->prev->next != p) ||
+     (p->next == NULL && (*list).tail != p) ||
+     (p->next != NULL && p->next->prev != p)){
     return -1;
   }
 
   // Process found.
-  if(current == (*list).tail){
-    (*list).tail = previous;
-    ((*list).tail)->next = NULL;
+  if(p->prev == NULL){
+    (*list).head = p->next;
+  } else{
+    p->prev->next = p->next;
+  }
+  if(p->next == NULL){
+    (*list).tail = p->prev;
   } else{
-    previous->next = current->next;
+    p->next->prev = p->prev;
   }
 
-  // Make sure p->next doesn't point into the list.
+  // Make sure p->next and p->prev don't point into the list.
   p->next = NULL;
+  p->prev = NULL;
 
   return 0;
 }
 #endif
 
-#if defined(CS333_P3)
+#if defined(CS333_P4)
+// Per-CPU ready list helpers.  Each cpu owns MLFQ ready lists and a
+// real-time list that is served first; p->rq records which cpu's lists
+// currently hold p so it can be removed without searching every cpu.
+// readyAdd() treats c as a preference (the waker's or yielder's cpu)
+// and readyPlace() overrides it when p->affinity forbids c.  All
+// require ptable.lock, so the lists are per-cpu data behind the one
+// global lock: they give locality and stealing but every enqueue,
+// dispatch and steal still serializes on ptable.lock.  A runqueue lock
+// per cpu would only help once ptable.lock is off the sched() path,
+// which today it guards for the state lists, sleep queues and timers.
 static void
-initProcessLists()
+readyAdd(struct cpu *c, struct proc *p)
 {
-  int i;
+  readyInsert(c, p, 0);
+  reschedKick(p->rq, p);
+}
 
-  for (i = UNUSED; i <= ZOMBIE; i++) {
-    ptable.list[i].head = NULL;
-    ptable.list[i].tail = NULL;
+// Should p, just queued, take the cpu from r?  Real-time procs beat
+// MLFQ procs and EDF procs beat later deadlines and FIFO procs.  Among
+// MLFQ procs a higher level wins, or in the fair builds a vruntime
+// smaller by more than FAIR_WAKEUPGRAN, so procs that wake often do
+// not preempt on every wakeup.
+static int
+preempts(struct proc *p, struct proc *r)
+{
+  if(r == NULL){
+    return 1;
   }
-#if defined(CS333_P4)
-  for (i = 0; i <= MAXPRIO; i++) {
-    ptable.ready[i].head = NULL;
-    ptable.ready[i].tail = NULL;
+  if(p->sched != SCHED_MLFQ){
+    return r->sched == SCHED_MLFQ || rtBefore(p, r);
   }
-#endif
+  #ifdef CS333_FAIR
+  return r->sched == SCHED_MLFQ &&
+         (long long)(r->vruntime - p->vruntime) > FAIR_WAKEUPGRAN;
+  #else
+  return r->sched == SCHED_MLFQ && p->priority > r->priority;
+  #endif // CS333_FAIR
 }
-#endif
 
-#if defined(CS333_P3)
+// Ask c to reschedule.  Another cpu is interrupted unless a request is
+// already on its way; this cpu sees the flag on its way out of trap().
 static void
-initFreeList(void)
+reschedCpu(struct cpu *c)
 {
-  struct proc* p;
-
-  for(p = ptable.proc; p < ptable.proc + NPROC; ++p){
-    p->state = UNUSED;
-    stateListAdd(&ptable.list[UNUSED], p);
+  if(c == mycpu()){
+    c->resched = 1;
+  } else if(xchg(&c->resched, 1) == 0){
+    lapicipi(c->apicid, T_IRQ0 + IRQ_RESCHED);
   }
 }
-#endif
 
-#if defined(CS333_P3)
-// example usage:
-// assertState(p, UNUSED, __FUNCTION__, __LINE__);
-// This code uses gcc preprocessor directives. For details, see
+// p was queued on c.  Preempt c if p should run before what c is
+// running, including nothing.  Otherwise wake an idle cpu that may
+// steal p rather than leave it waiting for c.
+static void
+reschedKick(struct cpu *c, struct proc *p)
+{
+  struct cpu *d;
+
+  if(preempts(p, c->proc)){
+    reschedCpu(c);
+    return;
+  }
+  for(d = cpus; d < &cpus[ncpu]; d++){
+    if(d != c && d->started && d->proc == NULL && (p->affinity & (1 << (d - cpus)))){
+      reschedCpu(d);
+      return;
+    }
+  }
+}
+
+// Does real-time proc a run before b?  EDF procs come first, earliest
+// deadline first; FIFO procs follow in arrival order.
+static int
+rtBefore(struct proc *a, struct proc *b)
+{
+  if(a->sched != SCHED_EDF){
+    return 0;
+  }
+  return b->sched != SCHED_EDF || (int)(a->deadline - b->deadline) < 0;
+}
+
+// Queue p on c's real-time list, ahead of its equals when front is set.
+static void
+rtAdd(struct cpu *c, struct proc *p, int front)
+{
+  struct proc *q = c->rt.head;
+
+  while(q && (front ? rtBefore(q, p) : !rtBefore(p, q))){
+    q = q->next;
+  }
+  if(q == NULL){
+    stateListAdd(&c->rt, p);
+    return;
+  }
+  if(q->prev == NULL){
+    stateListAddHead(&c->rt, p);
+    return;
+  }
+  p->next = q;
+  p->prev = q->prev;
+  q->prev->next = p;
+  q->prev = p;
+}
+
+static void
+readyInsert(struct cpu *c, struct proc *p, int front)
+{
+  c = readyPlace(c, p);
+  readySync(c);
+  promoteProc(p);
+  if(p->sched != SCHED_MLFQ){
+    // An EDF proc whose deadline has passed starts a new period.
+    if(p->sched == SCHED_EDF && (int)(ticks - p->deadline) >= 0){
+      p->deadline = ticks + p->period;
+      p->rtused = 0;
+    }
+    rtAdd(c, p, front);
+  } else{
+    #ifdef CS333_FAIR
+    fairAdd(c, p);
+    #else
+    #ifdef CS333_SHARE
+    shareWake(p->share);
+    shareQueueAdd(c, p);
+    #endif // CS333_SHARE
+    stateListAdd(&c->ready[p->priority], p);
+    c->readymask |= 1 << p->priority;
+    #endif // CS333_FAIR
+  }
+  p->rq = c;
+  c->nready++;
+  procTouch(p);
+}
+
+static int
+readyRemove(struct proc *p)
+{
+  struct cpu *c = p->rq;
+
+  if(c == NULL){
+    return -1;
+  }
+  readySync(c);
+  promoteProc(p);
+  if(p->sched != SCHED_MLFQ){
+    if(stateListRemove(&c->rt, p) == -1){
+      return -1;
+    }
+  } else{
+    #ifdef CS333_FAIR
+    rberase(&c->fairq, &p->rbnode);
+    #else
+    if(stateListRemove(&c->ready[p->priority], p) == -1){
+      return -1;
+    }
+    if(c->ready[p->priority].head == NULL){
+      c->readymask &= ~(1 << p->priority);
+    }
+    #ifdef CS333_SHARE
+    shareQueueRemove(c, p);
+    #endif // CS333_SHARE
+    #endif // CS333_FAIR
+  }
+  p->rq = NULL;
+  c->nready--;
+  return 0;
+}
+
+// Remove and return the head of c's real-time list, or else of its
+// highest priority non empty ready list.  readymask finds that list
+// with a single bsr instead of a scan.  The CFS and stride builds take
+// the leftmost proc of the tree instead.
+static struct proc*
+readyTake(struct cpu *c)
+{
+  struct proc *p;
+  #if !defined(CS333_FAIR) && !defined(CS333_SHARE)
+  int i;
+  #endif
+
+  if((p = c->rt.head) != NULL){
+    if(readyRemove(p) == -1){
+      panic("Process Not Found In Ready Lists!");
+    }
+    return p;
+  }
+  #ifdef CS333_FAIR
+  if(c->fairq.first == NULL){
+    return NULL;
+  }
+  p = rbentry(c->fairq.first, struct proc, rbnode);
+  if((long long)(p->vruntime - c->minvr) > 0){
+    c->minvr = p->vruntime;
+  }
+  #else
+  readySync(c);
+  if(c->readymask == 0){
+    return NULL;
+  }
+  #ifdef CS333_SHARE
+  p = shareTake(c);
+  #else
+  i = bsr(c->readymask);
+  p = c->ready[i].head;
+  if(p){
+    promoteProc(p);
+  }
+  if(p == NULL || p->priority != i){
+    panic("Process Not Found in Correct Ready List!");
+  }
+  #endif // CS333_SHARE
+  #endif // CS333_FAIR
+  if(readyRemove(p) == -1){
+    panic("Process Not Found In Ready Lists!");
+  }
+  return p;
+}
+
+// Pick the cpu whose lists p joins: the preferred cpu c if p may run
+// there, else the cpu p last ran on (its caches are warm), else the
+// first cpu p's affinity allows.
+static struct cpu*
+readyPlace(struct cpu *c, struct proc *p)
+{
+  struct cpu *d;
+
+  // An EDF proc runs only on the cpu that admitted its reservation.
+  if(p->rtcpu){
+    return p->rtcpu;
+  }
+  if(p->affinity & (1 << (c - cpus))){
+    return c;
+  }
+  if(p->lastcpu && (p->affinity & (1 << (p->lastcpu - cpus)))){
+    return p->lastcpu;
+  }
+  for(d = cpus; d < &cpus[ncpu]; d++){
+    if(p->affinity & (1 << (d - cpus))){
+      return d;
+    }
+  }
+  return c;
+}
+
+// Highest priority proc on peer that may run on c, or null.  Procs that
+// last ran on peer are passed over when another candidate exists at the
+// same level, since their caches are warm there.
+static struct proc*
+readyStealable(struct cpu *peer, struct cpu *c)
+{
+  struct proc *p;
+  struct proc *warm;
+  uint bit = 1 << (c - cpus);
+
+  for(p = peer->rt.head; p; p = p->next){
+    if((p->affinity & bit) && p->rtcpu == NULL){
+      return p;
+    }
+  }
+  #ifdef CS333_FAIR
+  warm = NULL;
+  for(struct rbnode *n = peer->fairq.first; n; n = rbnext(n)){
+    p = rbentry(n, struct proc, rbnode);
+    if(!(p->affinity & bit)){
+      continue;
+    }
+    if(p->lastcpu != peer){
+      return p;
+    }
+    if(warm == NULL){
+      warm = p;
+    }
+  }
+  return warm;
+  #else
+  readySync(peer);
+  #ifdef CS333_SHARE
+  // Steal from the uid with the lowest pass that has a proc c may run.
+  warm = NULL;
+  for(int s = 0; s < NSHARE; s++){
+    if(peer->sharemask[s] == 0 ||
+       (warm && ptable.shares[s].pass >= warm->share->pass)){
+      continue;
+    }
+    if((p = shareStealable(peer, s, bit)) != NULL){
+      warm = p;
+    }
+  }
+  return warm;
+  #else
+  for(int i = MAXPRIO; i > -1; --i){
+    warm = NULL;
+    for(p = peer->ready[i].head; p; p = p->next){
+      if(!(p->affinity & bit)){
+        continue;
+      }
+      if(p->lastcpu != peer){
+        return p;
+      }
+      if(warm == NULL){
+        warm = p;
+      }
+    }
+    if(warm){
+      return warm;
+    }
+  }
+  return NULL;
+  #endif // CS333_SHARE
+  #endif // CS333_FAIR
+}
+
+// Choose the next proc for c.  Local work comes first so procs stay on
+// the cpu they were enqueued on; an idle cpu steals from the busiest
+// peer holding something it is allowed to run.
+static struct proc*
+readySelect(struct cpu *c)
+{
+  struct cpu *peer;
+  struct cpu *busiest = NULL;
+  struct proc *p;
+  struct proc *steal = NULL;
+
+  // A proc handed this cpu by yieldto() runs first unless real-time
+  // work is waiting.
+  if((p = c->handoff) != NULL){
+    c->handoff = NULL;
+    if(p->state == RUNNABLE && p->rq == c &&
+       (p->sched != SCHED_MLFQ || c->rt.head == NULL)){
+      if(readyRemove(p) == -1){
+        panic("Process Not Found In Ready Lists!");
+      }
+      return p;
+    }
+  }
+  if((p = readyTake(c)) != NULL){
+    return p;
+  }
+  for(peer = cpus; peer < &cpus[ncpu]; peer++){
+    if(peer == c || peer->nready == 0 ||
+        (busiest && peer->nready <= busiest->nready)){
+      continue;
+    }
+    if((p = readyStealable(peer, c)) != NULL){
+      busiest = peer;
+      steal = p;
+    }
+  }
+  if(steal == NULL){
+    return NULL;
+  }
+  if(readyRemove(steal) == -1){
+    panic("Process Not Found In Ready Lists!");
+  }
+  #ifdef CS333_FAIR
+  // Carry the proc's lead or lag over busiest's floor to c's.
+  if(steal->sched == SCHED_MLFQ){
+    steal->vruntime = steal->vruntime - busiest->minvr + c->minvr;
+  }
+  #endif // CS333_FAIR
+  #ifdef CS333_SHARE
+  if(steal->sched == SCHED_MLFQ){
+    shareServe(steal->share);
+  }
+  #endif // CS333_SHARE
+  return steal;
+}
+
+// Is anything queued on any cpu?  Called without ptable.lock, so the
+// answer is only a hint; the caller rechecks under the lock.
+static int
+readyPending(void)
+{
+  struct cpu *c;
+
+  for(c = cpus; c < &cpus[ncpu]; c++){
+    if(c->nready > 0){
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Charge the running proc p for its cpu time.  MLFQ procs spend their
+// budget and drop a level when it runs out.  EDF procs spend their
+// runtime; each runtime used up pushes the deadline back one period,
+// so a proc that overruns its reservation cannot starve other EDF
+// procs.  FIFO procs are never demoted.
+static void
+budgetCharge(struct proc *p)
+{
+  uint usec;
+  uint64 rtusec = (uint64)p->runtime * (1000000 / TPS);
+
+  promoteProc(p);
+  usec = cpuCharge(p);
+  // A boost read from a stale lock owner in inheritwait() may land on a
+  // proc that holds no sleeplocks.
+  if(p->boosted && p->held == NULL){
+    unboost(p);
+  }
+  if(p->sched == SCHED_EDF){
+    p->rtused += usec;
+    while(p->rtused >= rtusec){
+      p->rtused -= rtusec;
+      p->deadline += p->period;
+    }
+  } else if(p->sched == SCHED_MLFQ){
+    #if defined(CS333_CFS)
+    p->vruntime += div64((uint64)usec * NICE_0_WEIGHT, cfsWeight(p));
+    #elif defined(CS333_STRIDE)
+    // pass advances by one stride per quantum of cpu used.
+    p->vruntime += div64((uint64)usec * p->stride, STRIDE_QUANTUM);
+    #else
+    #ifdef CS333_SHARE
+    p->share->pass += div64((uint64)usec * DEFAULT_UIDWEIGHT, p->share->weight);
+    p->share->usage += usec;
+    #endif // CS333_SHARE
+    if(MAXPRIO == 0){
+      return;
+    }
+    p->budget = p->budget - usec;
+    if(p->budget <= 0){
+      // A boosted proc keeps the inherited level until it releases
+      // the lock; the demotion applies to its own priority.
+      if(p->boosted){
+        if(p->basepri > 0){
+          p->basepri -= 1;
+        }
+      } else if(p->priority > 0){
+        p->priority -= 1;
+      }
+      p->budget = levelBudget(p->boosted ? p->basepri : p->priority);
+    }
+    #endif
+  }
+}
+
+// A level's budget in microseconds, the unit of p->budget.
+static int
+levelBudget(int level)
+{
+  return ptable.levels[level].budget * (1000000 / TPS);
+}
+
+// Length of the slice p is given when it is dispatched.  Only the
+// MLFQ levels have their own quanta.
+static uint
+sliceTicks(struct proc *p)
+{
+  #ifndef CS333_FAIR
+  if(p->sched == SCHED_MLFQ){
+    return ptable.levels[p->priority].quantum;
+  }
+  #endif // CS333_FAIR
+  return SCHED_INTERVAL;
+}
+
+// The running proc p is blocking.  If it waits on a device, through
+// sleepio(), before its slice is up it is treated as interactive and
+// moves up a level with a fresh budget.  Lock, pipe and timer sleeps
+// earn nothing, so a cpu-bound proc cannot climb by blocking briefly
+// every slice.  A boosted proc gets the raise on its own priority.
+static void
+ioBoost(struct proc *p)
+{
+  #ifndef CS333_FAIR
+  int level;
+  #endif // CS333_FAIR
+
+  if(!p->iowait){
+    return;
+  }
+  p->iowait = 0;
+  #ifndef CS333_FAIR
+  if(p->sched != SCHED_MLFQ || (int)(ticks - mycpu()->sliceend) >= 0){
+    return;
+  }
+  if(p->boosted){
+    level = basePriority(p);
+    if(level < MAXPRIO){
+      p->basepri = level + 1;
+      p->baseepoch = ptable.promoteEpoch;
+      p->budget = levelBudget(level + 1);
+    }
+  } else if(p->priority < MAXPRIO){
+    p->priority += 1;
+    p->budget = levelBudget(p->priority);
+  }
+  #endif // CS333_FAIR
+}
+
+// Called from trap() on the way back to the running proc.  Should it
+// give up the cpu?  It does when reschedKick() asked it to.  On timer
+// ticks it also does when its slice is up, and at each SCHED_INTERVAL
+// when higher priority work is queued on its cpu, so a long low
+// priority slice does not hold up an interactive proc.  The ready
+// state is read without ptable.lock and is only a hint.
+int
+preemptdue(int tick)
+{
+  struct cpu *c;
+  struct proc *p;
+  int due;
+
+  pushcli();
+  c = mycpu();
+  p = c->proc;
+  if(c->resched){
+    due = 1;
+  } else if(!tick){
+    due = 0;
+  } else if((int)(ticks - c->sliceend) >= 0){
+    due = 1;
+  } else if(ticks % SCHED_INTERVAL != 0 || p->sched != SCHED_MLFQ){
+    due = 0;
+  } else{
+    due = c->rt.head != NULL || (c->readymask >> (p->priority + 1)) != 0;
+  }
+  popcli();
+  return due;
+}
+
+int
+setlevel(int level, struct levelinfo *li)
+{
+  acquire(&ptable.lock);
+  ptable.levels[level] = *li;
+  release(&ptable.lock);
+  return 0;
+}
+
+int
+getlevel(int level, struct levelinfo *li)
+{
+  acquire(&ptable.lock);
+  *li = ptable.levels[level];
+  release(&ptable.lock);
+  return 0;
+}
+
+#ifdef CS333_CFS
+// Weights for nice -20..19, each step about 1.25x the next (as in Linux).
+static const uint cfsWeights[40] = {
+  88761, 71755, 56483, 46273, 36291,
+  29154, 23254, 18705, 14949, 11916,
+  9548, 7620, 6100, 4904, 3906,
+  3121, 2501, 1991, 1586, 1277,
+  1024, 820, 655, 526, 423,
+  335, 272, 215, 172, 137,
+  110, 87, 70, 56, 45,
+  36, 29, 23, 18, 15,
+};
+
+// priority acts as a nice value: each level is two nice steps, and the
+// middle level weighs NICE_0_WEIGHT.
+static uint
+cfsWeight(struct proc *p)
+{
+  int nice = MAXPRIO - 2 * p->priority;
+
+  if(nice < -20){
+    nice = -20;
+  } else if(nice > 19){
+    nice = 19;
+  }
+  return cfsWeights[nice + 20];
+}
+#endif // CS333_CFS
+
+#ifdef CS333_FAIR
+static int
+fairLess(struct rbnode *a, struct rbnode *b)
+{
+  return (long long)(rbentry(a, struct proc, rbnode)->vruntime -
+                     rbentry(b, struct proc, rbnode)->vruntime) < 0;
+}
+
+// Queue p on c's tree.  A proc that slept or is new to c starts no
+// further behind than FAIR_SLEEPCREDIT, so it runs soon but cannot
+// monopolise the cpu to catch up.  Stride gives no credit: a returning
+// proc joins at the cpu's global pass.
+static void
+fairAdd(struct cpu *c, struct proc *p)
+{
+  uint64 floor = c->minvr - FAIR_SLEEPCREDIT;
+
+  if((long long)(p->vruntime - floor) < 0){
+    p->vruntime = floor;
+  }
+  rbinsert(&c->fairq, &p->rbnode, fairLess);
+}
+#endif // CS333_FAIR
+
+// Lazy MLFQ promotion.  Each TICKS_TO_PROMOTE the scheduler just bumps
+// ptable.promoteEpoch.  A proc catches up on the epochs it missed when
+// it is next enqueued, dequeued or inspected (promoteProc()), and a
+// cpu's ready lists catch up by shifting whole lists up one level per
+// epoch (readySync()).  Both give the same result as promoting every
+// proc at the deadline.
+
+// Priority p would have after the epochs it has not seen yet.
+static int
+promotedPriority(struct proc *p)
+{
+  uint n = ptable.promoteEpoch - p->epoch;
+
+  if(n == 0 || p->priority >= MAXPRIO || p->sched != SCHED_MLFQ){
+    return p->priority;
+  }
+  return n >= MAXPRIO - p->priority ? MAXPRIO : p->priority + n;
+}
+
+static void
+promoteProc(struct proc *p)
+{
+  if(p->epoch == ptable.promoteEpoch){
+    return;
+  }
+  // Real-time procs are never promoted.
+  if(p->priority < MAXPRIO && p->sched == SCHED_MLFQ) // Prevents prio over MAXPRIO or promoting procs at MAXPRIO
+  {
+    p->priority = promotedPriority(p);
+    p->budget = levelBudget(p->priority);
+  }
+  p->epoch = ptable.promoteEpoch;
+}
+
+// Shift c's ready lists up one level per missed epoch.  The list just
+// below MAXPRIO is appended to the MAXPRIO list, matching the order the
+// old promotion pass produced.  After MAXPRIO shifts every queued proc
+// is at MAXPRIO, so more epochs change nothing.
+static void
+readySync(struct cpu *c)
+{
+  uint n = ptable.promoteEpoch - c->epoch;
+  struct ptrs *top = &c->ready[MAXPRIO];
+  struct ptrs *below;
+
+  c->epoch = ptable.promoteEpoch;
+  if(n > MAXPRIO){
+    n = MAXPRIO;
+  }
+  while(n-- > 0){
+    below = &c->ready[MAXPRIO-1];
+    if(below->head){
+      if(top->head == NULL){
+        top->head = below->head;
+      } else{
+        top->tail->next = below->head;
+        below->head->prev = top->tail;
+      }
+      top->tail = below->tail;
+    }
+    for(int i = MAXPRIO-1; i > 0; --i){
+      c->ready[i] = c->ready[i-1];
+    }
+    c->ready[0].head = NULL;
+    c->ready[0].tail = NULL;
+    c->readymask = ((c->readymask << 1) | (c->readymask & (1 << MAXPRIO))) &
+                   ((1 << (MAXPRIO+1)) - 1);
+    #ifdef CS333_SHARE
+    shareShift(c);
+    #endif // CS333_SHARE
+  }
+}
+#endif // CS333_P4
+
+#if defined(CS333_P3)
+// Sleep queues.  A sleeping proc is on ptable.list[SLEEPING] and also on
+// the sleepq bucket picked by hashing p->chan, so wakeup1() only visits
+// procs that may be sleeping on its channel.  Uses the qnext/qprev links
+// so the state list stays intact for assertState() and the dumps.
+static uint
+sleepqHash(void *chan)
+{
+  return ((uint)chan * 2654435761u) >> (32 - SLEEPQBITS);
+}
+
+static void
+sleepqAdd(struct proc *p)
+{
+  struct ptrs *q = &ptable.sleepq[sleepqHash(p->chan)];
+
+  p->qnext = NULL;
+  p->qprev = q->tail;
+  if(q->tail == NULL){
+    q->head = p;
+  } else{
+    q->tail->qnext = p;
+  }
+  q->tail = p;
+}
+
+static void
+sleepqRemove(struct proc *p)
+{
+  struct ptrs *q = &ptable.sleepq[sleepqHash(p->chan)];
+
+  if(p->qprev == NULL){
+    q->head = p->qnext;
+  } else{
+    p->qprev->qnext = p->qnext;
+  }
+  if(p->qnext == NULL){
+    q->tail = p->qprev;
+  } else{
+    p->qnext->qprev = p->qprev;
+  }
+  p->qnext = NULL;
+  p->qprev = NULL;
+}
+#endif
+
+#if defined(CS333_P3)
+// Charge p for the cpu time used since it was dispatched or last
+// charged and return that time in microseconds.  The TSC gives
+// sub-tick accuracy once calibrated; until then whole ticks are used.
+static uint
+cpuCharge(struct proc *p)
+{
+  uint64 now = rdtsc();
+  uint usec;
+
+  if(clockcalibrated()){
+    usec = tscusec(now - p->cpu_tsc_in);
+  } else{
+    usec = (ticks - p->cpu_ticks_in) * (1000000 / TPS);
+  }
+  p->cpu_tsc_in = now;
+  p->cpu_ticks_in = ticks;
+  p->cpu_usec_total += usec;
+  p->cpu_ticks_total = div64(p->cpu_usec_total, 1000000 / TPS);
+  return usec;
+}
+#endif
+
+#if defined(CS333_P3)
+// Child list helpers.  A proc sits on its parent's kids list while it
+// is alive and moves to the parent's zombies list when it exits, so
+// exit() and wait() touch only real children.  All require ptable.lock.
+static void
+kidAdd(struct ptrs *list, struct proc *p)
+{
+  p->snext = NULL;
+  p->sprev = list->tail;
+  if(list->tail){
+    list->tail->snext = p;
+  } else{
+    list->head = p;
+  }
+  list->tail = p;
+}
+
+static void
+kidRemove(struct ptrs *list, struct proc *p)
+{
+  if(p->sprev == NULL){
+    list->head = p->snext;
+  } else{
+    p->sprev->snext = p->snext;
+  }
+  if(p->snext == NULL){
+    list->tail = p->sprev;
+  } else{
+    p->snext->sprev = p->sprev;
+  }
+  p->snext = NULL;
+  p->sprev = NULL;
+}
+
+// Move every proc on src to the end of dst and make parent their parent.
+static void
+kidSplice(struct ptrs *dst, struct ptrs *src, struct proc *parent)
+{
+  struct proc *p;
+
+  if(src->head == NULL){
+    return;
+  }
+  for(p = src->head; p; p = p->snext){
+    p->parent = parent;
+  }
+  if(dst->tail){
+    dst->tail->snext = src->head;
+    src->head->sprev = dst->tail;
+  } else{
+    dst->head = src->head;
+  }
+  dst->tail = src->tail;
+  src->head = NULL;
+  src->tail = NULL;
+}
+#endif
+
+#if defined(CS333_P3)
+// pid hash.  allocproc() adds a proc when it hands out a pid and wait()
+// (or a failed allocproc()/fork()) removes it, so every pid that names
+// a live proc is found in its bucket.  Pids are handed out in order, so
+// the low bits spread them evenly.  All require ptable.lock.
+static void
+pidhashAdd(struct proc *p)
+{
+  struct proc **b = &ptable.pidhash[p->pid & (NPIDHASH-1)];
+
+  p->hnext = *b;
+  *b = p;
+}
+
+static void
+pidhashRemove(struct proc *p)
+{
+  struct proc **pp = &ptable.pidhash[p->pid & (NPIDHASH-1)];
+
+  while(*pp){
+    if(*pp == p){
+      *pp = p->hnext;
+      p->hnext = NULL;
+      return;
+    }
+    pp = &(*pp)->hnext;
+  }
+  panic("pidhashRemove: pid not hashed");
+}
+
+// ptable.live links every proc from allocproc() until wait() reaps it,
+// so ^P and getprocs() visit only procs in use.
+static void
+liveAdd(struct proc *p)
+{
+  p->lnext = NULL;
+  p->lprev = ptable.live.tail;
+  if(ptable.live.tail){
+    ptable.live.tail->lnext = p;
+  } else{
+    ptable.live.head = p;
+  }
+  ptable.live.tail = p;
+  ptable.nlive++;
+}
+
+static void
+liveRemove(struct proc *p)
+{
+  if(p->lprev == NULL){
+    ptable.live.head = p->lnext;
+  } else{
+    p->lprev->lnext = p->lnext;
+  }
+  if(p->lnext == NULL){
+    ptable.live.tail = p->lprev;
+  } else{
+    p->lnext->lprev = p->lprev;
+  }
+  p->lnext = NULL;
+  p->lprev = NULL;
+  ptable.nlive--;
+}
+
+static struct proc*
+pidLookup(int pid)
+{
+  struct proc *p;
+
+  for(p = ptable.pidhash[pid & (NPIDHASH-1)]; p; p = p->hnext){
+    if(p->pid == pid){
+      return p;
+    }
+  }
+  return NULL;
+}
+#endif
+
+#if defined(CS333_P3)
+// Timer wheel helpers.  All require ptable.lock.  This is the classic
+// hierarchical wheel: a timer due within TVR_SIZE ticks of timerBase
+// sits in tv1 under its exact tick; later ones sit in a coarser tvn
+// slot and are cascaded down as timerBase reaches them.
+static void
+timerSlotAdd(struct ptrs *slot, struct proc *p)
+{
+  p->tnext = NULL;
+  p->tprev = slot->tail;
+  if(slot->tail == NULL){
+    slot->head = p;
+  } else{
+    slot->tail->tnext = p;
+  }
+  slot->tail = p;
+  p->tslot = slot;
+}
+
+static void
+timerRemove(struct proc *p)
+{
+  struct ptrs *slot = p->tslot;
+
+  if(p->tprev == NULL){
+    slot->head = p->tnext;
+  } else{
+    p->tprev->tnext = p->tnext;
+  }
+  if(p->tnext == NULL){
+    slot->tail = p->tprev;
+  } else{
+    p->tnext->tprev = p->tprev;
+  }
+  p->tnext = NULL;
+  p->tprev = NULL;
+  p->tslot = NULL;
+  ptable.ntimers--;
+}
+
+// File p under p->wakeat, relative to the wheel's current base.
+// Deadlines are never behind timerBase: sleepticks() only arms a
+// deadline that is still in the future.
+static void
+timerFile(struct proc *p)
+{
+  uint expires = p->wakeat;
+  uint delta = expires - ptable.timerBase;
+  int level;
+
+  if(delta < TVR_SIZE){
+    timerSlotAdd(&ptable.tv1[expires & TVR_MASK], p);
+    return;
+  }
+  if(delta > TV_MAXDELTA){
+    // Beyond the wheel's range; park in the furthest slot and refile
+    // from p->wakeat when that slot cascades.
+    expires = ptable.timerBase + TV_MAXDELTA;
+    delta = TV_MAXDELTA;
+  }
+  for(level = 0; level < TVN_LEVELS - 1; level++){
+    if(delta < 1 << (TVR_BITS + (level + 1) * TVN_BITS))
+      break;
+  }
+  timerSlotAdd(&ptable.tvn[level][(expires >> (TVR_BITS + level * TVN_BITS)) & TVN_MASK], p);
+}
+
+static void
+timerAdd(struct proc *p)
+{
+  if(ptable.ntimers == 0){
+    // Nothing pending, so the wheel can skip straight to now.
+    ptable.timerBase = ticks;
+    ptable.timerNext = p->wakeat;
+  } else if((int)(p->wakeat - ptable.timerNext) < 0){
+    ptable.timerNext = p->wakeat;
+  }
+  ptable.ntimers++;
+  timerFile(p);
+}
+
+// Move every proc in tvn[level][index] down to a finer slot.
+static int
+timerCascade(int level, int index)
+{
+  struct ptrs *slot = &ptable.tvn[level][index];
+  struct proc *p = slot->head;
+  struct proc *next;
+
+  slot->head = NULL;
+  slot->tail = NULL;
+  while(p){
+    next = p->tnext;
+    timerFile(p);
+    p = next;
+  }
+  return index;
+}
+
+#define TVN_INDEX(n) ((ptable.timerBase >> (TVR_BITS + (n) * TVN_BITS)) & TVN_MASK)
+
+// Fire every timer due at or before now, then recompute timerNext.
+static void
+timerRun(uint now)
+{
+  struct proc *p;
+  struct ptrs *slot;
+  int index;
+  int level;
+  uint t;
+
+  while((int)(now - ptable.timerBase) >= 0){
+    index = ptable.timerBase & TVR_MASK;
+    if(index == 0){
+      for(level = 0; level < TVN_LEVELS; level++){
+        if(timerCascade(level, TVN_INDEX(level)) != 0)
+          break;
+      }
+    }
+    slot = &ptable.tv1[index];
+    ptable.timerBase++;
+    while((p = slot->head) != NULL){
+      timerRemove(p);
+      wakeup1(&p->wakeat);
+    }
+  }
+
+  // tv1 holds everything due before the next cascade, so the first
+  // occupied slot up to that point is the next deadline.  If there is
+  // none, look again when the cascade refills tv1.
+  ptable.timerNext = (ptable.timerBase | TVR_MASK) + 1;
+  for(t = ptable.timerBase; t != ptable.timerNext; t++){
+    if(ptable.tv1[t & TVR_MASK].head){
+      ptable.timerNext = t;
+      break;
+    }
+  }
+}
+#endif
+
+#if defined(CS333_P3)
+static void
+initProcessLists()
+{
+  int i;
+
+  for (i = UNUSED; i <= ZOMBIE; i++) {
+    ptable.list[i].head = NULL;
+    ptable.list[i].tail = NULL;
+  }
+  for (i = 0; i < NSLEEPQ; i++) {
+    ptable.sleepq[i].head = NULL;
+    ptable.sleepq[i].tail = NULL;
+  }
+  memset(ptable.pidhash, 0, sizeof(ptable.pidhash));
+  ptable.live.head = NULL;
+  ptable.live.tail = NULL;
+  ptable.nlive = 0;
+  ptable.maxproc = DEFAULT_MAXPROC;
+  ptable.nslab = 0;
+  memset(ptable.tv1, 0, sizeof(ptable.tv1));
+  memset(ptable.tvn, 0, sizeof(ptable.tvn));
+  ptable.timerBase = ticks;
+  ptable.ntimers = 0;
+#if defined(CS333_P4)
+  struct cpu *c;
+
+  for (c = cpus; c < &cpus[NCPU]; c++) {
+    for (i = 0; i <= MAXPRIO; i++) {
+      c->ready[i].head = NULL;
+      c->ready[i].tail = NULL;
+    }
+    c->nready = 0;
+    c->readymask = 0;
+    c->rt.head = NULL;
+    c->rt.tail = NULL;
+    c->rtutil = 0;
+    #ifdef CS333_SHARE
+    memset(c->shareq, 0, sizeof(c->shareq));
+    memset(c->sharemask, 0, sizeof(c->sharemask));
+    #endif // CS333_SHARE
+    #ifdef CS333_FAIR
+    rbinit(&c->fairq);
+    c->minvr = 0;
+    #endif // CS333_FAIR
+  }
+#endif
+}
+#endif
+
+#if defined(CS333_P3)
+// Procs come from pages of kalloc() memory.  Start with one page; more
+// are added by allocproc() as needed and never given back, so the
+// UNUSED list works as a cache of recycled procs.
+static void
+initFreeList(void)
+{
+  if(procSlabGrow() == -1)
+    panic("initFreeList: out of memory");
+}
+
+// Carve a fresh page into UNUSED procs.  Requires ptable.lock once
+// other cpus can run.
+static int
+procSlabGrow(void)
+{
+  struct proc *p;
+  char *page;
+  int i;
+
+  if(PGSIZE / sizeof(struct proc) == 0)
+    panic("procSlabGrow: struct proc too large");
+  if((page = kalloc()) == 0)
+    return -1;
+  memset(page, 0, PGSIZE);
+  p = (struct proc*)page;
+  for(i = 0; i < PGSIZE / sizeof(struct proc); i++, p++){
+    p->slot = ptable.nslot++;
+    p->state = UNUSED;
+    stateListAdd(&ptable.list[UNUSED], p);
+  }
+  ptable.nslab++;
+  return 0;
+}
+#endif
+
+#if defined(CS333_P3)
+// example usage:
+// assertState(p, UNUSED, __FUNCTION__, __LINE__);
+// This code uses gcc preprocessor directives. For details, see
 // https://gcc.gnu.org/onlinedocs/cpp/Standard-Predefined-Macros.html
 static void
 assertState(struct proc *p, enum procstate state, const char * func, int line)
@@ -1841,220 +3409,881 @@ assertState(struct proc *p, enum procstate state, const char * func, int line)
         states[p->state], states[state], func, line);
     panic("Error: Process state incorrect in assertState()");
 }
-#endif
+#endif
+
+#if defined(CS333_P2)
+int 
+getuid(void)
+{
+    int ret = 0;
+    acquire(&ptable.lock);
+    ret = myproc()->uid;
+    release(&ptable.lock);
+    return ret;
+}
+
+int
+getgid(void)
+{
+    int ret = 0;
+    acquire(&ptable.lock);
+    ret = myproc()->gid;
+    release(&ptable.lock);
+    return ret;
+}
+int
+getppid(void)
+{
+    int ret = 0;
+    acquire(&ptable.lock);
+    if(myproc()->parent == NULL)
+    {
+      ret = myproc()->pid;
+    }
+    else
+    {
+      ret = myproc()->parent->pid;
+    }
+    release(&ptable.lock);
+    return ret;
+}
+int
+setuid(int uid)
+{
+    acquire(&ptable.lock);
+    myproc()->uid = uid;
+    #ifdef CS333_SHARE
+    shareSet(myproc(), shareLookup(uid));
+    #endif // CS333_SHARE
+    release(&ptable.lock);
+    return 0;
+}
+
+int
+setgid(int gid)
+{
+    acquire(&ptable.lock);
+    myproc()->gid = gid;
+    release(&ptable.lock);
+    return 0;    
+}
+
+int
+getprocs(int max, struct uproc * table)
+{
+  struct proc *p;
+  int num = 0;
+  #ifdef CS333_SHARE
+  uint64 usage = 0;
+  int i;
+  #endif // CS333_SHARE
+  acquire(&ptable.lock);
+  #ifdef CS333_SHARE
+  for(i = 0; i < NSHARE; i++)
+    usage += ptable.shares[i].usage;
+  #endif // CS333_SHARE
+  #ifdef CS333_P3
+  for(p = ptable.live.head; p; p = p->lnext){
+  #else
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+  #endif // CS333_P3
+    if(p->state == RUNNABLE || p->state == SLEEPING || p->state == RUNNING || p->state == ZOMBIE)
+    {
+      table[num].pid = p->pid;
+      table[num].uid = p->uid;
+      table[num].gid = p->gid;
+      if(p->parent == NULL)
+      {
+        table[num].ppid = p->pid;
+      }
+      else
+      {
+        table[num].ppid = p->parent->pid;
+      }
+      #ifdef CS333_P4
+      if(p->state == RUNNABLE){
+        readySync(p->rq);
+      }
+      promoteProc(p);
+      table[num].priority = p->priority;
+      table[num].cpu = p->lastcpu ? p->lastcpu - cpus : -1;
+      table[num].sched = p->sched;
+      #endif //CS333_P4
+      #ifdef CS333_STRIDE
+      table[num].tickets = p->tickets;
+      #endif //CS333_STRIDE
+      #ifdef CS333_SHARE
+      table[num].uidweight = p->share->weight;
+      table[num].uidshare = usage ? div64(p->share->usage * 1000, usage) : 0;
+      #endif //CS333_SHARE
+      table[num].elapsed_ticks = ticks - p->start_ticks;
+      table[num].CPU_total_ticks = p->cpu_ticks_total;
+      #ifdef CS333_P3
+      table[num].CPU_usec = p->cpu_usec_total -
+                            (uint64)p->cpu_ticks_total * (1000000 / TPS);
+      #endif // CS333_P3
+      safestrcpy(table[num].state, states[p->state], STRMAX);
+      table[num].size = p->sz;
+      safestrcpy(table[num].name, p->name, STRMAX);
+      num++;
+    }
+    if(num == max)
+    {
+      release(&ptable.lock);
+      return num;
+    }
+  }
+  release(&ptable.lock);
+  return num;
+}
+#endif //CS333_P2
+
+#ifdef CS333_P3
+// Stamp p with a new generation and move it to the tail of
+// ptable.genlist, which keeps every proc in generation order.  Every
+// state change passes through here via stateListAdd() or readyInsert().
+static void
+procTouch(struct proc *p)
+{
+  p->gen = ++ptable.gen;
+  if(ptable.genlist.tail == p)
+    return;
+  if(p->gprev || ptable.genlist.head == p){
+    if(p->gprev)
+      p->gprev->gnext = p->gnext;
+    else
+      ptable.genlist.head = p->gnext;
+    p->gnext->gprev = p->gprev;
+  }
+  p->gnext = NULL;
+  p->gprev = ptable.genlist.tail;
+  if(ptable.genlist.tail)
+    ptable.genlist.tail->gnext = p;
+  else
+    ptable.genlist.head = p;
+  ptable.genlist.tail = p;
+}
+
+// Cap the number of live procs at n and return the old cap.  Procs
+// already past the new cap keep running; only allocproc() refuses.
+int
+setmaxproc(int n)
+{
+  int old;
+
+  acquire(&ptable.lock);
+  old = ptable.maxproc;
+  ptable.maxproc = n;
+  release(&ptable.lock);
+  return old;
+}
+
+// Fill rec[] with the procs whose state changed after generation *gen,
+// oldest change first, and advance *gen to the last one copied.  Only
+// the changed procs are visited.  A caller that gets back max records
+// should call again for the rest.
+int
+procsnap(uint *gen, int max, struct procrec *rec)
+{
+  struct proc *p;
+  uint since = *gen;
+  int n = 0;
+
+  acquire(&ptable.lock);
+  p = ptable.genlist.tail;
+  if(p == NULL || (int)(p->gen - since) <= 0){
+    release(&ptable.lock);
+    return 0;
+  }
+  while(p->gprev && (int)(p->gprev->gen - since) > 0)
+    p = p->gprev;
+  for(; p && n < max; p = p->gnext, n++){
+    rec[n].slot = p->slot;
+    rec[n].pid = p->state == UNUSED ? 0 : p->pid;
+    rec[n].ppid = p->parent ? p->parent->pid : p->pid;
+    rec[n].uid = p->uid;
+    rec[n].size = p->sz;
+    rec[n].cpu_ticks = p->cpu_ticks_total;
+    if(p->state == RUNNING)
+      rec[n].cpu_ticks += ticks - p->cpu_ticks_in;
+    rec[n].start_ticks = p->start_ticks;
+    rec[n].state = p->state;
+    #ifdef CS333_P4
+    if(p->state == RUNNABLE){
+      readySync(p->rq);
+    }
+    promoteProc(p);
+    rec[n].priority = p->priority;
+    rec[n].cpu = p->lastcpu ? p->lastcpu - cpus : -1;
+    rec[n].sched = p->sched;
+    #else
+    rec[n].priority = 0;
+    rec[n].cpu = -1;
+    rec[n].sched = 0;
+    #endif // CS333_P4
+    memmove(rec[n].name, p->name, sizeof rec[n].name);
+    since = p->gen;
+  }
+  release(&ptable.lock);
+  *gen = since;
+  return n;
+}
+#endif // CS333_P3
+
+#ifdef CS333_P4
+int
+setpriority(int pid, int priority)
+{
+  struct proc *p;
+  struct cpu *rq;
+
+  acquire(&ptable.lock);
+  p = pidLookup(pid);
+  if(p == NULL || (p->state != RUNNABLE && p->state != SLEEPING && p->state != RUNNING)){
+    release(&ptable.lock);
+    return -1;
+  }
+  if(p->state == RUNNABLE){
+    readySync(p->rq);
+  }
+  promoteProc(p);
+  if(p->boosted){
+    // The new priority becomes the one restored on release, and only
+    // replaces the inherited one if it is higher.
+    p->basepri = priority;
+    p->baseepoch = ptable.promoteEpoch;
+    if(priority <= p->priority){
+      release(&ptable.lock);
+      return 0;
+    }
+  }
+  if(p->priority == priority){
+    release(&ptable.lock);
+    return 0;
+  }
+  if(p->state == RUNNABLE){
+    // Requeue on the same cpu at the new priority.
+    rq = p->rq;
+    if(readyRemove(p) == -1)
+    {
+      panic("Not on Ready Lists!");
+    }
+    p->priority = priority;
+    p->budget = levelBudget(priority);
+    readyAdd(rq, p);
+  } else{
+    p->priority = priority;
+    p->budget = levelBudget(priority);
+  }
+  release(&ptable.lock);
+  return 0;
+}
+
+// Priority inheritance for sleeplocks.  A proc about to sleep on a held
+// sleeplock lends its priority to the owner, and on through the lock
+// that owner is itself waiting for.  A boosted owner is requeued at the
+// inherited level at once, so the next scheduling decision sees it.
+// Taking a contended lock or releasing one while boosted recomputes
+// the owner's level from the waiters on every lock it still holds.
+// Real-time waiters lend MAXPRIO; real-time owners already outrank the
+// MLFQ.  An uncontended lock never touches ptable.lock: the owner and
+// held fields are written under the sleeplock's own spinlock, and a
+// proc's held list is only used by that proc.
+
+// p's current priority with missed promotions applied.
+static int
+syncPriority(struct proc *p)
+{
+  if(p->state == RUNNABLE){
+    readySync(p->rq);
+  }
+  promoteProc(p);
+  return p->priority;
+}
+
+// Set p's priority, moving it between ready lists if it is queued.  The
+// cpu it is queued on is kicked in case p now outranks what it runs.
+static void
+requeuePriority(struct proc *p, int priority)
+{
+  struct cpu *rq = p->rq;
+
+  if(p->state == RUNNABLE){
+    if(readyRemove(p) == -1){
+      panic("Not on Ready Lists!");
+    }
+    p->priority = priority;
+    readyAdd(rq, p);
+  } else{
+    p->priority = priority;
+  }
+}
+
+// The priority a boosted p would have had on its own.
+static int
+basePriority(struct proc *p)
+{
+  uint n = ptable.promoteEpoch - p->baseepoch;
+
+  return n >= MAXPRIO - p->basepri ? MAXPRIO : p->basepri + n;
+}
+
+// Drop an inherited priority.  p must not be on a ready list.
+static void
+unboost(struct proc *p)
+{
+  promoteProc(p);
+  p->priority = basePriority(p);
+  p->boosted = 0;
+}
+
+// Highest priority lent by procs blocked on the locks p holds, or -1.
+static int
+inheritedPriority(struct proc *p)
+{
+  struct sleeplock *lk;
+  struct proc *w;
+  int prio = -1;
+
+  for(lk = p->held; lk; lk = lk->heldnext){
+    for(w = ptable.sleepq[sleepqHash(lk)].head; w; w = w->qnext){
+      if(w->chan != lk || w->waitlock != lk){
+        continue;
+      }
+      if(w->sched != SCHED_MLFQ){
+        return MAXPRIO;
+      }
+      prio = max(prio, syncPriority(w));
+    }
+  }
+  return prio;
+}
+
+// Recompute the running proc's priority from its own and what its
+// waiters lend it.
+static void
+inheritUpdate(struct proc *p)
+{
+  int prio = inheritedPriority(p);
+
+  if(p->boosted){
+    unboost(p);
+  }
+  syncPriority(p);
+  if(p->sched != SCHED_MLFQ || prio <= p->priority){
+    return;
+  }
+  p->boosted = 1;
+  p->basepri = p->priority;
+  p->baseepoch = ptable.promoteEpoch;
+  p->priority = prio;
+}
+
+// The caller is about to sleep on lk, which another proc holds.
+// Caller must hold lk->lk.
+void
+inheritwait(struct sleeplock *lk)
+{
+  struct proc *curproc = myproc();
+  struct proc *p, *q;
+  struct sleeplock *wl;
+  int prio;
+
+  acquire(&ptable.lock);
+  curproc->waitlock = lk;
+  prio = curproc->sched != SCHED_MLFQ ? MAXPRIO : syncPriority(curproc);
+  // waitlock only changes under ptable.lock, but past the first hop the
+  // owner is read without that lock's spinlock.  An owner whose pid is
+  // not the lock's has released it or been reused, so the walk stops
+  // there.  The two fields are not written as one, so a stale owner can
+  // still slip through; budgetCharge() drops a boost left on a proc
+  // that holds no sleeplocks.
+  for(p = lk->owner; p && p->sched == SCHED_MLFQ; p = q){
+    if(syncPriority(p) >= prio){
+      break;
+    }
+    if(!p->boosted){
+      p->boosted = 1;
+      p->basepri = p->priority;
+      p->baseepoch = ptable.promoteEpoch;
+    }
+    requeuePriority(p, prio);
+    if((wl = p->waitlock) == NULL){
+      break;
+    }
+    q = wl->owner;
+    if(q == NULL || q->pid != wl->pid){
+      break;
+    }
+  }
+  release(&ptable.lock);
+}
+
+// The caller has taken lk.  Caller must hold lk->lk.
+void
+inherittake(struct sleeplock *lk)
+{
+  struct proc *curproc = myproc();
+
+  lk->owner = curproc;
+  lk->heldnext = curproc->held;
+  curproc->held = lk;
+  if(curproc->waitlock == NULL && lk->nwaiting == 0){
+    return;
+  }
+  acquire(&ptable.lock);
+  curproc->waitlock = NULL;
+  inheritUpdate(curproc);
+  release(&ptable.lock);
+}
+
+// The caller is releasing lk.  Caller must hold lk->lk.
+void
+inheritdrop(struct sleeplock *lk)
+{
+  struct proc *curproc = myproc();
+  struct sleeplock **pp;
+
+  for(pp = &curproc->held; *pp; pp = &(*pp)->heldnext){
+    if(*pp == lk){
+      *pp = lk->heldnext;
+      break;
+    }
+  }
+  lk->owner = NULL;
+  lk->heldnext = NULL;
+  if(!curproc->boosted){
+    return;
+  }
+  acquire(&ptable.lock);
+  inheritUpdate(curproc);
+  release(&ptable.lock);
+}
 
-#if defined(CS333_P2)
-int 
-getuid(void)
+int
+getpriority(int pid)
 {
-    int ret = 0;
-    acquire(&ptable.lock);
-    ret = myproc()->uid;
+  struct proc *p;
+  int ret;
+
+  acquire(&ptable.lock);
+  p = pidLookup(pid);
+  if(p == NULL || (p->state != RUNNABLE && p->state != SLEEPING && p->state != RUNNING)){
     release(&ptable.lock);
-    return ret;
+    return -1;
+  }
+  if(p->state == RUNNABLE){
+    readySync(p->rq);
+  }
+  promoteProc(p);
+  ret = p->priority;
+  release(&ptable.lock);
+  return ret;
 }
 
+// Restrict pid to the cpus in mask.  A queued proc moves to an allowed
+// cpu now; a running one moves the next time it is enqueued.  An EDF
+// proc may not leave the cpu that admitted its reservation.
 int
-getgid(void)
+setaffinity(int pid, uint mask)
 {
-    int ret = 0;
-    acquire(&ptable.lock);
-    ret = myproc()->gid;
+  struct proc *p;
+  struct cpu *rq;
+
+  mask &= (1 << ncpu) - 1;
+  if(mask == 0){
+    return -1;
+  }
+  acquire(&ptable.lock);
+  p = pidLookup(pid);
+  if(p == NULL || p->state == UNUSED || p->state == ZOMBIE ||
+     (p->rtcpu && !(mask & (1 << (p->rtcpu - cpus))))){
     release(&ptable.lock);
-    return ret;
-}
-int
-getppid(void)
-{
-    int ret = 0;
-    acquire(&ptable.lock);
-    if(myproc()->parent == NULL)
-    {
-      ret = myproc()->pid;
-    }
-    else
+    return -1;
+  }
+  p->affinity = mask;
+  rq = p->rq;
+  if(p->state == RUNNABLE && !(mask & (1 << (rq - cpus)))){
+    if(readyRemove(p) == -1)
     {
-      ret = myproc()->parent->pid;
+      panic("Not on Ready Lists!");
     }
-    release(&ptable.lock);
-    return ret;
+    readyAdd(rq, p);
+  }
+  release(&ptable.lock);
+  return 0;
 }
+
 int
-setuid(int uid)
+getaffinity(int pid)
 {
-    acquire(&ptable.lock);
-    myproc()->uid = uid;
+  struct proc *p;
+  int ret;
+
+  acquire(&ptable.lock);
+  p = pidLookup(pid);
+  if(p == NULL || p->state == UNUSED || p->state == ZOMBIE){
     release(&ptable.lock);
-    return 0;
+    return -1;
+  }
+  ret = p->affinity & ((1 << ncpu) - 1);
+  release(&ptable.lock);
+  return ret;
 }
 
-int
-setgid(int gid)
+// Give back the cpu capacity held by p's EDF reservation.
+static void
+rtRelease(struct proc *p)
 {
-    acquire(&ptable.lock);
-    myproc()->gid = gid;
-    release(&ptable.lock);
-    return 0;    
+  if(p->rtcpu){
+    p->rtcpu->rtutil -= p->rtutil;
+    p->rtcpu = NULL;
+  }
+  p->rtutil = 0;
+}
+
+// The cpu that can take util more thousandths of EDF reservation for
+// p: the one p is on if it has room, else the allowed cpu with the most
+// room.  Null if no allowed cpu stays within RT_MAXUTIL.
+static struct cpu*
+rtAdmit(struct proc *p, uint util)
+{
+  struct cpu *c = p->rq ? p->rq : p->lastcpu;
+  struct cpu *best = NULL;
+
+  if(c && (p->affinity & (1 << (c - cpus))) && c->rtutil + util <= RT_MAXUTIL){
+    return c;
+  }
+  for(c = cpus; c < &cpus[ncpu]; c++){
+    if(!(p->affinity & (1 << (c - cpus))) || c->rtutil + util > RT_MAXUTIL){
+      continue;
+    }
+    if(best == NULL || c->rtutil < best->rtutil){
+      best = c;
+    }
+  }
+  return best;
 }
 
+// Move pid to scheduling class class.  SCHED_EDF takes a period of at
+// most MAXPERIOD ticks and a runtime no longer than the period.  It is
+// admitted on one cpu p may run on, which must stay within RT_MAXUTIL,
+// and the proc then runs only there; no cpu with room means -1.
+// Moving back to SCHED_MLFQ restarts the proc with a full budget at
+// its old priority.
 int
-getprocs(int max, struct uproc * table)
+setsched(int pid, int class, uint period, uint runtime)
 {
   struct proc *p;
-  int num = 0;
+  struct cpu *rq = NULL;
+  struct cpu *rtcpu = NULL;
+  uint util = 0;
+
+  if(class != SCHED_MLFQ && class != SCHED_FIFO && class != SCHED_EDF){
+    return -1;
+  }
+  if(class == SCHED_EDF){
+    if(period == 0 || period > MAXPERIOD || runtime == 0 || runtime > period){
+      return -1;
+    }
+    util = div64((uint64)runtime * 1000, period);
+    if(util == 0){
+      util = 1;
+    }
+  }
   acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->state == RUNNABLE || p->state == SLEEPING || p->state == RUNNING || p->state == ZOMBIE)
-    {
-      table[num].pid = p->pid;
-      table[num].uid = p->uid;
-      table[num].gid = p->gid;
-      if(p->parent == NULL)
-      {
-        table[num].ppid = p->pid;
-      }
-      else
-      {
-        table[num].ppid = p->parent->pid;
-      }
-      #ifdef CS333_P4
-      table[num].priority = p->priority;
-      #endif //CS333_P4
-      table[num].elapsed_ticks = ticks - p->start_ticks;
-      table[num].CPU_total_ticks = p->cpu_ticks_total;
-      safestrcpy(table[num].state, states[p->state], STRMAX);
-      table[num].size = p->sz;
-      safestrcpy(table[num].name, p->name, STRMAX);
-      num++;
+  p = pidLookup(pid);
+  if(p == NULL || p->state == UNUSED || p->state == ZOMBIE){
+    release(&ptable.lock);
+    return -1;
+  }
+  // p's old reservation does not count against its new one.
+  if(p->rtcpu){
+    p->rtcpu->rtutil -= p->rtutil;
+  }
+  if(class == SCHED_EDF && (rtcpu = rtAdmit(p, util)) == NULL){
+    if(p->rtcpu){
+      p->rtcpu->rtutil += p->rtutil;
     }
-    if(num == max)
+    release(&ptable.lock);
+    return -1;
+  }
+  if(p->state == RUNNABLE){
+    rq = p->rq;
+    if(readyRemove(p) == -1)
     {
-      release(&ptable.lock);
-      return num;
+      panic("Not on Ready Lists!");
     }
   }
+  p->rtcpu = rtcpu;
+  p->rtutil = util;
+  if(rtcpu){
+    rtcpu->rtutil += util;
+  }
+  p->sched = class;
+  p->period = period;
+  p->runtime = runtime;
+  p->deadline = ticks + period;
+  p->rtused = 0;
+  p->budget = levelBudget(p->priority);
+  if(rq){
+    readyAdd(rq, p);
+  } else if(rtcpu && p->state == RUNNING && p->lastcpu != rtcpu){
+    // Move to the admitting cpu at the next preemption.
+    reschedCpu(p->lastcpu);
+  }
   release(&ptable.lock);
-  return num;
+  return 0;
 }
-#endif //CS333_P2
+#endif // CS333_P4
 
-#ifdef CS333_P4
+#ifdef CS333_STRIDE
+// Give pid a new ticket count.  Its pass keeps going from where it is,
+// only later quanta advance it by the new stride.
 int
-setpriority(int pid, int priority)
+settickets(int pid, int tickets)
 {
+  struct proc *p;
+
   acquire(&ptable.lock);
+  p = pidLookup(pid);
+  if(p == NULL || p->state == UNUSED || p->state == ZOMBIE){
+    release(&ptable.lock);
+    return -1;
+  }
+  p->tickets = tickets;
+  p->stride = STRIDE1 / tickets;
+  release(&ptable.lock);
+  return 0;
+}
+
+int
+gettickets(int pid)
+{
   struct proc *p;
+  int ret;
 
-  for(int i = MAXPRIO; i > -1; --i)
-  {
-    p = ptable.ready[i].head;
-    while(p)
-    {
-      if(p->pid == pid)
-      {
-        if(p->priority == priority)
-        {
-          release(&ptable.lock);
-          return 0;
-        }
-        if(stateListRemove(&ptable.ready[p->priority], p) == -1)
-        {
-          panic("Not on Ready Lists!");
-        }
-        p->priority = priority;
-        p->budget = BUDGET;
-        stateListAdd(&ptable.ready[p->priority], p);
-        release(&ptable.lock);
-        return 0;
-      }
-      p = p->next;
-    }
+  acquire(&ptable.lock);
+  p = pidLookup(pid);
+  if(p == NULL || p->state == UNUSED || p->state == ZOMBIE){
+    release(&ptable.lock);
+    return -1;
   }
+  ret = p->tickets;
+  release(&ptable.lock);
+  return ret;
+}
+#endif // CS333_STRIDE
+
+#ifdef CS333_SHARE
+// Fair-share build.  Each uid has a pass that advances by the cpu its
+// procs use divided by the uid's weight.  readyTake() serves the queued
+// uid with the lowest pass and, within it, the proc the MLFQ would pick.
+// So cpu is split between uids by weight first and between a uid's
+// procs by priority second.
+
+// The entry for uid, claiming a free one if it has none.  Entries with
+// no procs and the default weight are free to reuse.  When the table
+// is full the uid shares the last entry with the other latecomers.
+static struct ushare*
+shareLookup(uint uid)
+{
+  struct ushare *u;
+  struct ushare *free = NULL;
 
-  p = ptable.list[SLEEPING].head;
-  while(p)
-  {
-    if(p->pid == pid)
-    {
-      if(p->priority == priority)
-      {
-          release(&ptable.lock);
-          return 0;
-      }
-      p->priority = priority;
-      p->budget = BUDGET;
-      release(&ptable.lock);
-      return 0;
+  for(u = ptable.shares; u < &ptable.shares[NSHARE-1]; u++){
+    if(u->weight != 0 && u->uid == uid){
+      return u;
+    }
+    if(free == NULL &&
+       (u->weight == 0 || (u->nproc == 0 && u->weight == DEFAULT_UIDWEIGHT))){
+      free = u;
     }
-    p = p->next;
   }
+  if(free == NULL){
+    return &ptable.shares[NSHARE-1];
+  }
+  free->uid = uid;
+  free->weight = DEFAULT_UIDWEIGHT;
+  free->pass = ptable.sharefloor;
+  free->usage = 0;
+  return free;
+}
 
-  p = ptable.list[RUNNING].head;
-  while(p)
-  {
-    if(p->pid == pid)
-    {
-      if(p->priority == priority)
-      {
-          release(&ptable.lock);
-          return 0;
+static void
+shareSet(struct proc *p, struct ushare *u)
+{
+  if(p->share){
+    p->share->nproc--;
+  }
+  p->share = u;
+  if(u){
+    u->nproc++;
+  }
+}
+
+// A uid coming back from idle may not bank more than a quantum of
+// credit against the uids that kept running.
+static void
+shareWake(struct ushare *u)
+{
+  if(u->pass + SHARE_SLEEPCREDIT < ptable.sharefloor){
+    u->pass = ptable.sharefloor - SHARE_SLEEPCREDIT;
+  }
+}
+
+// Each MLFQ proc queued on c is also on c->shareq[s][level], where s is
+// its share, in the same order as on c->ready[level].  sharemask[s]
+// tracks the non empty levels the way readymask does for ready[].
+static void
+shareQueueAdd(struct cpu *c, struct proc *p)
+{
+  int s = p->share - ptable.shares;
+  struct ptrs *q = &c->shareq[s][p->priority];
+
+  p->unext = NULL;
+  p->uprev = q->tail;
+  if(q->tail){
+    q->tail->unext = p;
+  } else{
+    q->head = p;
+  }
+  q->tail = p;
+  c->sharemask[s] |= 1 << p->priority;
+}
+
+static void
+shareQueueRemove(struct cpu *c, struct proc *p)
+{
+  int s = p->share - ptable.shares;
+  struct ptrs *q = &c->shareq[s][p->priority];
+
+  if(p->uprev){
+    p->uprev->unext = p->unext;
+  } else{
+    q->head = p->unext;
+  }
+  if(p->unext){
+    p->unext->uprev = p->uprev;
+  } else{
+    q->tail = p->uprev;
+  }
+  p->unext = NULL;
+  p->uprev = NULL;
+  if(q->head == NULL){
+    c->sharemask[s] &= ~(1 << p->priority);
+  }
+}
+
+// One epoch of readySync() applied to every share's lists.
+static void
+shareShift(struct cpu *c)
+{
+  struct ptrs *top;
+  struct ptrs *below;
+  int s, i;
+
+  for(s = 0; s < NSHARE; s++){
+    if(c->sharemask[s] == 0){
+      continue;
+    }
+    top = &c->shareq[s][MAXPRIO];
+    below = &c->shareq[s][MAXPRIO-1];
+    if(below->head){
+      if(top->head == NULL){
+        top->head = below->head;
+      } else{
+        top->tail->unext = below->head;
+        below->head->uprev = top->tail;
       }
-      p->priority = priority;
-      p->budget = BUDGET;
-      release(&ptable.lock);
-      return 0;
+      top->tail = below->tail;
     }
-    p = p->next;
+    for(i = MAXPRIO-1; i > 0; --i){
+      c->shareq[s][i] = c->shareq[s][i-1];
+    }
+    c->shareq[s][0].head = NULL;
+    c->shareq[s][0].tail = NULL;
+    c->sharemask[s] = ((c->sharemask[s] << 1) |
+                       (c->sharemask[s] & (1 << MAXPRIO))) &
+                      ((1 << (MAXPRIO+1)) - 1);
   }
-  release(&ptable.lock);
-  return -1;
 }
 
-int
-getpriority(int pid)
+// u was picked to run; wakers are held to within a quantum of it.
+static void
+shareServe(struct ushare *u)
 {
-  int ret = 0;
-  acquire(&ptable.lock);
+  if(u->pass > ptable.sharefloor){
+    ptable.sharefloor = u->pass;
+  }
+}
+
+// The highest priority proc of the lowest pass uid queued on c, found
+// without visiting the procs of other uids.  c must be synced and have
+// an MLFQ proc queued.  The proc is left on its lists.
+static struct proc*
+shareTake(struct cpu *c)
+{
+  struct ushare *best = NULL;
   struct proc *p;
-  for(int i = MAXPRIO; i > -1; --i)
-  {
-    p = ptable.ready[i].head;
-    while(p)
-    {
-      if(p->pid == pid)
-      {
-        ret = p->priority;
-        release(&ptable.lock);
-        return ret;
-      }
-      p = p->next;
+  int s;
+
+  for(s = 0; s < NSHARE; s++){
+    if(c->sharemask[s] &&
+       (best == NULL || ptable.shares[s].pass < best->pass)){
+      best = &ptable.shares[s];
     }
   }
+  s = best - ptable.shares;
+  p = c->shareq[s][bsr(c->sharemask[s])].head;
+  promoteProc(p);
+  shareServe(best);
+  return p;
+}
 
-  p = ptable.list[SLEEPING].head;
-  while(p)
-  {
-    if(p->pid == pid)
-    {
-      ret = p->priority;
-      release(&ptable.lock);
-      return ret;
+// readyStealable() restricted to the procs of share s on peer: the
+// highest level with one c may run, preferring procs whose caches are
+// not warm on peer.
+static struct proc*
+shareStealable(struct cpu *peer, int s, uint bit)
+{
+  struct proc *p;
+  struct proc *warm;
+
+  for(int i = MAXPRIO; i > -1; --i){
+    warm = NULL;
+    for(p = peer->shareq[s][i].head; p; p = p->unext){
+      if(!(p->affinity & bit)){
+        continue;
+      }
+      if(p->lastcpu != peer){
+        return p;
+      }
+      if(warm == NULL){
+        warm = p;
+      }
+    }
+    if(warm){
+      return warm;
     }
-    p = p->next;
   }
+  return NULL;
+}
 
-  p = ptable.list[RUNNING].head;
-  while(p)
-  {
-    if(p->pid == pid)
-    {
-      ret = p->priority;
-      release(&ptable.lock);
-      return ret;
-    }
-    p = p->next;
+int
+setuidweight(int uid, int weight)
+{
+  struct ushare *u;
+
+  acquire(&ptable.lock);
+  u = shareLookup(uid);
+  if(u == &ptable.shares[NSHARE-1]){
+    release(&ptable.lock);
+    return -1;
   }
+  u->weight = weight;
   release(&ptable.lock);
-  return -1;
+  return 0;
 }
-#endif // CS333_P4
+#endif // CS333_SHARE
+
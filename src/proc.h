@@ -1,5 +1,34 @@
-// Per-CPU state
+// The CFS and stride schedulers share a tree of runnable procs.
+#if defined(CS333_CFS) || defined(CS333_STRIDE)
+#define CS333_FAIR
+#include "rbtree.h"
+#endif
+
+#ifdef CS333_P3
+// record with head and tail pointer for constant-time access to the beginning
+// and end of a linked list of struct procs.  use with stateListAdd() and
+// stateListRemove().
+struct ptrs {
+  struct proc* head;
+  struct proc* tail;
+};
+#endif // CS333_P3
+
+#ifdef CS333_SHARE
+// A uid's share of the cpu in the fair-share build.
+struct ushare {
+  uint uid;
+  uint weight;                 // 0 while the entry is unused
+  int nproc;                   // procs charged to this entry
+  uint64 pass;                 // usec used, times DEFAULT_UIDWEIGHT / weight
+  uint64 usage;                // usec used, halved every LOAD_FREQ ticks
+};
+#endif // CS333_SHARE
+
+// Per-CPU state.  Each cpu writes its own entry constantly, so entries
+// are cache line aligned to keep neighbours from sharing a line.
 struct cpu {
+  struct cpu *self;            // %gs:0 holds this cpu's address; see seginit()
   uchar apicid;                // Local APIC ID
   struct context *scheduler;   // swtch() here to enter scheduler
   struct taskstate ts;         // Used by x86 to find stack for interrupt
@@ -8,7 +37,34 @@ struct cpu {
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
   struct proc *proc;           // The process running on this cpu or null
-};
+  #ifdef CS333_P3
+  int tickless;                // LAPIC timer is in one-shot idle mode
+  int armed;                   // the one-shot has not fired yet
+  uint idledeadline;           // tick the armed one-shot fires at
+  uint64 starttsc;             // TSC when this cpu entered scheduler()
+  uint64 idletsc;              // TSC cycles spent halted in scheduler()
+  #endif // CS333_P3
+  #ifdef CS333_P4
+  struct ptrs ready[MAXPRIO+1]; // This cpu's MLFQ ready lists
+  int nready;                  // Number of procs on ready[]
+  uint readymask;              // Bit i set when ready[i] is non empty
+  struct ptrs rt;              // Real-time procs: EDF by deadline, then FIFO
+  uint epoch;                  // Last promotion epoch applied to ready[]
+  struct proc *handoff;        // yieldto() target to run next, or null
+  uint handoffend;             // sliceend the yieldto() caller left to handoff
+  uint sliceend;               // ticks when the running proc's slice is up
+  volatile uint resched;       // set by reschedCpu(); cleared by scheduler()
+  uint rtutil;                 // EDF capacity reserved here, in thousandths
+  #endif // CS333_P4
+  #ifdef CS333_FAIR
+  struct rbroot fairq;         // MLFQ class procs ordered by vruntime
+  uint64 minvr;                // never decreasing floor of vruntime on fairq
+  #endif // CS333_FAIR
+  #ifdef CS333_SHARE
+  struct ptrs shareq[NSHARE][MAXPRIO+1]; // ready[] split by share, via unext/uprev
+  uint sharemask[NSHARE];      // bit i set when shareq[s][i] is non empty
+  #endif // CS333_SHARE
+} __attribute__((aligned(CACHELINE)));
 
 extern struct cpu cpus[NCPU];
 extern int ncpu;
@@ -35,16 +91,40 @@ enum procstate { UNUSED, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
 // Per-process state
 struct proc {
+  // Hot fields, read by the scheduler and by the walks in wakeup1()
+  // and kill().  They come first so that a walk touches one cache line
+  // of each proc it passes (two in the CFS and stride builds).
+  enum procstate state;        // Process state
+  void *chan;                  // If non-zero, sleeping on chan
+  uint pid;                    // Process ID
+  int killed;                  // If non-zero, have been killed
+  #ifdef CS333_P3
+  struct proc *next;
+  struct proc *prev;           // back pointer for O(1) stateListRemove()
+  struct proc *qnext;          // sleep queue links, bucket chosen by chan
+  struct proc *qprev;
+  struct proc *hnext;          // pid hash chain
+  #endif
+  #ifdef CS333_P4
+  int priority;
+  int budget;
+  struct cpu *rq;              // cpu whose ready lists hold this proc
+  uint epoch;                  // Last promotion epoch applied to priority
+  struct cpu *lastcpu;         // cpu this proc last ran on, or null
+  uint affinity;               // Bit i set when the proc may run on cpus[i]
+  int sched;                   // SCHED_MLFQ, SCHED_FIFO or SCHED_EDF
+  #endif
+  #ifdef CS333_FAIR
+  struct rbnode rbnode;        // link on the cpu's fairq
+  uint64 vruntime;             // CFS: weighted cpu usec; stride: the pass
+  #endif
+
   uint sz;                     // Size of process memory (bytes)
   pde_t* pgdir;                // Page table
   char *kstack;                // Bottom of kernel stack for this process
-  enum procstate state;        // Process state
-  uint pid;                    // Process ID
   struct proc *parent;         // Parent process. NULL indicates no parent
   struct trapframe *tf;        // Trap frame for current syscall
   struct context *context;     // swtch() here to run process
-  void *chan;                  // If non-zero, sleeping on chan
-  int killed;                  // If non-zero, have been killed
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
   char name[16];               // Process name (debugging)
@@ -59,15 +139,55 @@ struct proc {
 
   uint cpu_ticks_total;
   uint cpu_ticks_in;
+  #ifdef CS333_P3
+  uint64 cpu_tsc_in;           // TSC at dispatch or at the last cpuCharge()
+  uint64 cpu_usec_total;       // cpu time used, in microseconds
+  #endif // CS333_P3
   #endif // CS333_P2
   #ifdef CS333_P3
-  struct proc *next;
+  uint wakeat;                 // sleepticks() deadline
+  struct ptrs *tslot;          // timer wheel slot holding this proc, or null
+  struct proc *tnext;          // timer wheel slot links
+  struct proc *tprev;
+  struct ptrs kids;            // Live children, linked through snext/sprev
+  struct ptrs zombies;         // Exited children waiting to be reaped
+  struct proc *snext;          // sibling links on the parent's kids/zombies
+  struct proc *sprev;
+  struct proc *lnext;          // links on ptable.live while the proc is in use
+  struct proc *lprev;
+  int isthread;                // made by clone(); parent is the group leader
+  char *ustack;                // user stack page handed to clone()
+  struct ptrs threads;         // Leader only: live threads, via snext/sprev
+  struct ptrs tzombies;        // Leader only: exited threads awaiting join()
+  uint slot;                   // fixed index of this proc for procsnap()
+  uint gen;                    // ptable generation of the last state change
+  struct proc *gnext;          // links on ptable.genlist, oldest gen first
+  struct proc *gprev;
   #endif
   #ifdef CS333_P4
-  int priority;
-  int budget;
+  uint period;                 // SCHED_EDF period and runtime, in ticks
+  uint runtime;
+  uint deadline;               // SCHED_EDF absolute deadline
+  uint rtused;                 // usec of runtime used in this period
+  uint rtutil;                 // share of a cpu reserved, in thousandths
+  struct cpu *rtcpu;           // cpu that admitted the EDF reservation, or null
+  int boosted;                 // priority is inherited from sleeplock waiters
+  int basepri;                 // own priority while boosted, as of baseepoch
+  uint baseepoch;
+  struct sleeplock *waitlock;  // sleeplock this proc is blocked on, or null
+  struct sleeplock *held;      // sleeplocks held, linked through heldnext
+  int iowait;                  // next sleep is on a device; see sleepio()
   #endif
-};
+  #ifdef CS333_STRIDE
+  uint tickets;
+  uint stride;                 // STRIDE1 / tickets
+  #endif
+  #ifdef CS333_SHARE
+  struct ushare *share;        // the uid's entry in ptable.shares
+  struct proc *unext;          // links on rq->shareq while on a ready list
+  struct proc *uprev;
+  #endif
+} __attribute__((aligned(CACHELINE)));
 
 // Process memory is laid out contiguously, low addresses first:
 //   text
@@ -5,6 +5,14 @@
 #include "uproc.h"
 #include "pdx.h"
 
+#ifdef CS333_P4
+static char *classnames[] = {
+  [SCHED_MLFQ] "mlfq",
+  [SCHED_FIFO] "fifo",
+  [SCHED_EDF]  "edf",
+};
+#endif
+
 int
 main(int argc, char *argv[])
 {
@@ -19,13 +27,37 @@ main(int argc, char *argv[])
   }
   struct uproc *table = malloc(max * sizeof(struct uproc));
   int size = getprocs(max, table);
+#ifdef CS333_P3
+  // The kernel has no fixed process limit, so grow the table until
+  // everything fits unless the user asked for a maximum.
+  while(argc < 2 && size == max)
+  {
+    free(table);
+    max *= 2;
+    table = malloc(max * sizeof(struct uproc));
+    size = getprocs(max, table);
+  }
+#endif
   int spacer = 0;
   int sec = 0;
   int mill = 0;
   int c_sec = 0;
   int c_mill = 0;
-#ifdef CS333_P4
-  printf(1, "%s", "PID\tNAME         UID\tGID\tPPID\tPRIO\tELAPSED\tCPU\tSTATE\tSIZE\n");
+#ifdef CS333_STRIDE
+  // Achieved share is each proc's fraction of the cpu time used so far
+  // by every listed proc.
+  uint cpu_total = 0;
+  for(int i = 0; i < size; ++i)
+  {
+    cpu_total += table[i].CPU_total_ticks;
+  }
+  printf(1, "%s", "PID\tNAME         UID\tGID\tPPID\tPRIO\tELAPSED\tCPU\tSTATE\tSIZE\tONCPU\tCLASS\tTICKETS\tSHARE\n");
+#elif defined(CS333_SHARE)
+  // USHARE is the uid's fraction of recent cpu time, decayed like the
+  // load average.
+  printf(1, "%s", "PID\tNAME         UID\tGID\tPPID\tPRIO\tELAPSED\tCPU\tSTATE\tSIZE\tONCPU\tCLASS\tWEIGHT\tUSHARE\n");
+#elif defined(CS333_P4)
+  printf(1, "%s", "PID\tNAME         UID\tGID\tPPID\tPRIO\tELAPSED\tCPU\tSTATE\tSIZE\tONCPU\tCLASS\n");
 #else
   printf(1, "%s", "PID\tNAME         UID\tGID\tPPID\tELAPSED\tCPU\tSTATE\tSIZE\n");
 #endif
@@ -60,17 +92,54 @@ main(int argc, char *argv[])
     }
     if(c_mill < 10)
     {
-      printf(1, "%d.00%d\t", c_sec, c_mill);
+      printf(1, "%d.00%d", c_sec, c_mill);
     }
     else if(c_mill >= 10 && c_mill < 100)
     { 
-      printf(1, "%d.0%d\t", c_sec, c_mill);
+      printf(1, "%d.0%d", c_sec, c_mill);
     }
     else
     { 
-      printf(1, "%d.%d\t", c_sec, c_mill);
+      printf(1, "%d.%d", c_sec, c_mill);
+    }
+#ifdef CS333_P3
+    // CPU time is accounted to the microsecond
+    if(table[i].CPU_usec < 10)
+    {
+      printf(1, "00%d", table[i].CPU_usec);
+    }
+    else if(table[i].CPU_usec < 100)
+    {
+      printf(1, "0%d", table[i].CPU_usec);
     }
+    else
+    {
+      printf(1, "%d", table[i].CPU_usec);
+    }
+#endif
+    printf(1, "\t");
+#ifdef CS333_P4
+    printf(1, "%s\t%d\t", table[i].state, table[i].size);
+    if(table[i].cpu < 0)
+    {
+      printf(1, "-\t");
+    }
+    else
+    {
+      printf(1, "%d\t", table[i].cpu);
+    }
+#ifdef CS333_STRIDE
+    printf(1, "%s\t%d\t", classnames[table[i].sched], table[i].tickets);
+    printf(1, "%d%%\n", cpu_total ? table[i].CPU_total_ticks * 100 / cpu_total : 0);
+#elif defined(CS333_SHARE)
+    printf(1, "%s\t%d\t", classnames[table[i].sched], table[i].uidweight);
+    printf(1, "%d.%d%%\n", table[i].uidshare / 10, table[i].uidshare % 10);
+#else
+    printf(1, "%s\n", classnames[table[i].sched]);
+#endif
+#else
     printf(1, "%s\t%d\n", table[i].state, table[i].size); 
+#endif
   }
   free(table);
   exit();
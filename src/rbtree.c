@@ -0,0 +1,254 @@
+// Red-black tree used by the CFS and stride schedulers to keep
+// runnable procs sorted.  Nodes with equal keys keep insertion order.
+// Callers provide their own locking.
+
+#include "types.h"
+#include "defs.h"
+#include "rbtree.h"
+
+static void
+rotateleft(struct rbroot *t, struct rbnode *x)
+{
+  struct rbnode *y = x->right;
+
+  x->right = y->left;
+  if(y->left)
+    y->left->parent = x;
+  y->parent = x->parent;
+  if(x->parent == 0)
+    t->root = y;
+  else if(x == x->parent->left)
+    x->parent->left = y;
+  else
+    x->parent->right = y;
+  y->left = x;
+  x->parent = y;
+}
+
+static void
+rotateright(struct rbroot *t, struct rbnode *x)
+{
+  struct rbnode *y = x->left;
+
+  x->left = y->right;
+  if(y->right)
+    y->right->parent = x;
+  y->parent = x->parent;
+  if(x->parent == 0)
+    t->root = y;
+  else if(x == x->parent->right)
+    x->parent->right = y;
+  else
+    x->parent->left = y;
+  y->right = x;
+  x->parent = y;
+}
+
+// Put v where u was in u's parent.
+static void
+transplant(struct rbroot *t, struct rbnode *u, struct rbnode *v)
+{
+  if(u->parent == 0)
+    t->root = v;
+  else if(u == u->parent->left)
+    u->parent->left = v;
+  else
+    u->parent->right = v;
+  if(v)
+    v->parent = u->parent;
+}
+
+static int
+isred(struct rbnode *n)
+{
+  return n && n->red;
+}
+
+void
+rbinit(struct rbroot *t)
+{
+  t->root = 0;
+  t->first = 0;
+}
+
+// Insert n after every node it is not less than.
+void
+rbinsert(struct rbroot *t, struct rbnode *n,
+         int (*less)(struct rbnode*, struct rbnode*))
+{
+  struct rbnode **link = &t->root;
+  struct rbnode *p = 0;
+  struct rbnode *g, *u;
+  int leftmost = 1;
+
+  while(*link){
+    p = *link;
+    if(less(n, p)){
+      link = &p->left;
+    } else {
+      link = &p->right;
+      leftmost = 0;
+    }
+  }
+  n->parent = p;
+  n->left = 0;
+  n->right = 0;
+  n->red = 1;
+  *link = n;
+  if(leftmost)
+    t->first = n;
+
+  // Restore the red-black properties.
+  while((p = n->parent) != 0 && p->red){
+    g = p->parent;
+    if(p == g->left){
+      u = g->right;
+      if(isred(u)){
+        p->red = 0;
+        u->red = 0;
+        g->red = 1;
+        n = g;
+        continue;
+      }
+      if(n == p->right){
+        rotateleft(t, p);
+        n = p;
+        p = n->parent;
+      }
+      p->red = 0;
+      g->red = 1;
+      rotateright(t, g);
+    } else {
+      u = g->left;
+      if(isred(u)){
+        p->red = 0;
+        u->red = 0;
+        g->red = 1;
+        n = g;
+        continue;
+      }
+      if(n == p->left){
+        rotateright(t, p);
+        n = p;
+        p = n->parent;
+      }
+      p->red = 0;
+      g->red = 1;
+      rotateleft(t, g);
+    }
+  }
+  t->root->red = 0;
+}
+
+void
+rberase(struct rbroot *t, struct rbnode *z)
+{
+  struct rbnode *y = z;
+  struct rbnode *x, *p, *w;
+  int yred = y->red;
+
+  if(t->first == z)
+    t->first = rbnext(z);
+
+  if(z->left == 0){
+    x = z->right;
+    p = z->parent;
+    transplant(t, z, z->right);
+  } else if(z->right == 0){
+    x = z->left;
+    p = z->parent;
+    transplant(t, z, z->left);
+  } else {
+    y = z->right;
+    while(y->left)
+      y = y->left;
+    yred = y->red;
+    x = y->right;
+    if(y->parent == z){
+      p = y;
+    } else {
+      p = y->parent;
+      transplant(t, y, y->right);
+      y->right = z->right;
+      y->right->parent = y;
+    }
+    transplant(t, z, y);
+    y->left = z->left;
+    y->left->parent = y;
+    y->red = z->red;
+  }
+  if(yred)
+    return;
+
+  // A black node left the tree; restore the black heights.
+  while(x != t->root && !isred(x)){
+    if(x == p->left){
+      w = p->right;
+      if(w->red){
+        w->red = 0;
+        p->red = 1;
+        rotateleft(t, p);
+        w = p->right;
+      }
+      if(!isred(w->left) && !isred(w->right)){
+        w->red = 1;
+        x = p;
+        p = x->parent;
+      } else {
+        if(!isred(w->right)){
+          w->left->red = 0;
+          w->red = 1;
+          rotateright(t, w);
+          w = p->right;
+        }
+        w->red = p->red;
+        p->red = 0;
+        w->right->red = 0;
+        rotateleft(t, p);
+        x = t->root;
+      }
+    } else {
+      w = p->left;
+      if(w->red){
+        w->red = 0;
+        p->red = 1;
+        rotateright(t, p);
+        w = p->left;
+      }
+      if(!isred(w->left) && !isred(w->right)){
+        w->red = 1;
+        x = p;
+        p = x->parent;
+      } else {
+        if(!isred(w->left)){
+          w->right->red = 0;
+          w->red = 1;
+          rotateleft(t, w);
+          w = p->left;
+        }
+        w->red = p->red;
+        p->red = 0;
+        w->left->red = 0;
+        rotateright(t, p);
+        x = t->root;
+      }
+    }
+  }
+  if(x)
+    x->red = 0;
+}
+
+// In-order successor of n, or null.
+struct rbnode*
+rbnext(struct rbnode *n)
+{
+  if(n->right){
+    n = n->right;
+    while(n->left)
+      n = n->left;
+    return n;
+  }
+  while(n->parent && n == n->parent->right)
+    n = n->parent;
+  return n->parent;
+}
@@ -0,0 +1,22 @@
+#ifndef RBTREE_INCLUDE
+#define RBTREE_INCLUDE
+
+// Intrusive red-black tree.  Embed a struct rbnode in the object being
+// sorted and recover the object from a node with rbentry().  The tree
+// caches its leftmost node so the minimum is found in constant time.
+struct rbnode {
+  struct rbnode *parent;
+  struct rbnode *left;
+  struct rbnode *right;
+  int red;
+};
+
+struct rbroot {
+  struct rbnode *root;
+  struct rbnode *first;        // leftmost node, or null when empty
+};
+
+#define rbentry(n, type, member) \
+  ((type*)((char*)(n) - (uint)&((type*)0)->member))
+
+#endif // RBTREE_INCLUDE
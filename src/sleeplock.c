@@ -17,6 +17,11 @@ initsleeplock(struct sleeplock *lk, char *name)
   lk->name = name;
   lk->locked = 0;
   lk->pid = 0;
+#ifdef CS333_P4
+  lk->owner = 0;
+  lk->heldnext = 0;
+  lk->nwaiting = 0;
+#endif // CS333_P4
 }
 
 void
@@ -24,10 +29,20 @@ acquiresleep(struct sleeplock *lk)
 {
   acquire(&lk->lk);
   while (lk->locked) {
+#ifdef CS333_P4
+    lk->nwaiting++;
+    inheritwait(lk);  // lend our priority to the holder
     sleep(lk, &lk->lk);
+    lk->nwaiting--;
+#else
+    sleep(lk, &lk->lk);
+#endif // CS333_P4
   }
   lk->locked = 1;
   lk->pid = myproc()->pid;
+#ifdef CS333_P4
+  inherittake(lk);
+#endif // CS333_P4
   release(&lk->lk);
 }
 
@@ -37,7 +52,10 @@ releasesleep(struct sleeplock *lk)
   acquire(&lk->lk);
   lk->locked = 0;
   lk->pid = 0;
-  wakeup(lk);
+#ifdef CS333_P4
+  inheritdrop(lk);
+#endif // CS333_P4
+  wakeup_one(lk);
   release(&lk->lk);
 }
 
@@ -6,5 +6,11 @@ struct sleeplock {
   // For debugging:
   char *name;        // Name of lock.
   int pid;           // Process holding lock
+#ifdef CS333_P4
+  // Priority inheritance
+  struct proc *owner;          // Process holding lock
+  struct sleeplock *heldnext;  // next lock on owner->held
+  int nwaiting;                // procs asleep in acquiresleep()
+#endif // CS333_P4
 };
 
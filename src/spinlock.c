@@ -105,22 +105,27 @@ void
 pushcli(void)
 {
   int eflags;
+  struct cpu *c;
 
   eflags = readeflags();
   cli();
-  if(mycpu()->ncli == 0)
-    mycpu()->intena = eflags & FL_IF;
-  mycpu()->ncli += 1;
+  c = mycpu();
+  if(c->ncli == 0)
+    c->intena = eflags & FL_IF;
+  c->ncli += 1;
 }
 
 void
 popcli(void)
 {
+  struct cpu *c;
+
   if(readeflags()&FL_IF)
     panic("popcli - interruptible");
-  if(--mycpu()->ncli < 0)
+  c = mycpu();
+  if(--c->ncli < 0)
     panic("popcli");
-  if(mycpu()->ncli == 0 && mycpu()->intena)
+  if(c->ncli == 0 && c->intena)
     sti();
 }
 
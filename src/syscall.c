@@ -120,7 +120,32 @@ extern int sys_getprocs(void);
 #ifdef CS333_P4
 extern int sys_setpriority(void);
 extern int sys_getpriority(void);
+extern int sys_setaffinity(void);
+extern int sys_getaffinity(void);
+extern int sys_setsched(void);
 #endif // CS333_P4
+#ifdef CS333_STRIDE
+extern int sys_settickets(void);
+extern int sys_gettickets(void);
+#endif // CS333_STRIDE
+#ifdef CS333_P3
+extern int sys_clone(void);
+extern int sys_join(void);
+extern int sys_getload(void);
+extern int sys_yield(void);
+extern int sys_yield_to(void);
+extern int sys_procsnap(void);
+#endif // CS333_P3
+#ifdef CS333_SHARE
+extern int sys_setuidweight(void);
+#endif // CS333_SHARE
+#ifdef CS333_P4
+extern int sys_setlevel(void);
+extern int sys_getlevel(void);
+#endif // CS333_P4
+#ifdef CS333_P3
+extern int sys_setmaxproc(void);
+#endif // CS333_P3
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -161,6 +186,31 @@ static int (*syscalls[])(void) = {
 #ifdef CS333_P4
 [SYS_setpriority] sys_setpriority,
 [SYS_getpriority] sys_getpriority,
+[SYS_setaffinity] sys_setaffinity,
+[SYS_getaffinity] sys_getaffinity,
+[SYS_setsched] sys_setsched,
+#endif
+#ifdef CS333_STRIDE
+[SYS_settickets] sys_settickets,
+[SYS_gettickets] sys_gettickets,
+#endif
+#ifdef CS333_P3
+[SYS_clone]   sys_clone,
+[SYS_join]    sys_join,
+[SYS_getload] sys_getload,
+[SYS_yield]   sys_yield,
+[SYS_yield_to] sys_yield_to,
+[SYS_procsnap] sys_procsnap,
+#endif
+#ifdef CS333_SHARE
+[SYS_setuidweight] sys_setuidweight,
+#endif
+#ifdef CS333_P4
+[SYS_setlevel] sys_setlevel,
+[SYS_getlevel] sys_getlevel,
+#endif
+#ifdef CS333_P3
+[SYS_setmaxproc] sys_setmaxproc,
 #endif
 };
 
@@ -205,6 +255,33 @@ static char *syscallnames[] = {
   [SYS_setpriority] "setpriority",
   [SYS_getpriority] "getpriority",
 #endif
+#ifdef CS333_P4
+  [SYS_setaffinity] "setaffinity",
+  [SYS_getaffinity] "getaffinity",
+  [SYS_setsched] "setsched",
+#endif
+#ifdef CS333_STRIDE
+  [SYS_settickets] "settickets",
+  [SYS_gettickets] "gettickets",
+#endif
+#ifdef CS333_P3
+  [SYS_clone] "clone",
+  [SYS_join] "join",
+  [SYS_getload] "getload",
+  [SYS_yield] "yield",
+  [SYS_yield_to] "yield_to",
+  [SYS_procsnap] "procsnap",
+#endif
+#ifdef CS333_SHARE
+  [SYS_setuidweight] "setuidweight",
+#endif
+#ifdef CS333_P4
+  [SYS_setlevel] "setlevel",
+  [SYS_getlevel] "getlevel",
+#endif
+#ifdef CS333_P3
+  [SYS_setmaxproc] "setmaxproc",
+#endif
 };
 #endif // PRINT_SYSCALLS
 
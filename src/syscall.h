@@ -31,3 +31,18 @@
 #define SYS_getprocs SYS_setgid+1
 #define SYS_setpriority SYS_getprocs+1
 #define SYS_getpriority SYS_setpriority+1
+#define SYS_setaffinity SYS_getpriority+1
+#define SYS_getaffinity SYS_setaffinity+1
+#define SYS_setsched SYS_getaffinity+1
+#define SYS_settickets SYS_setsched+1
+#define SYS_gettickets SYS_settickets+1
+#define SYS_clone SYS_gettickets+1
+#define SYS_join SYS_clone+1
+#define SYS_getload SYS_join+1
+#define SYS_yield SYS_getload+1
+#define SYS_yield_to SYS_yield+1
+#define SYS_procsnap SYS_yield_to+1
+#define SYS_setuidweight SYS_procsnap+1
+#define SYS_setlevel SYS_setuidweight+1
+#define SYS_getlevel SYS_setlevel+1
+#define SYS_setmaxproc SYS_getlevel+1
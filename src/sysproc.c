@@ -66,10 +66,16 @@ int
 sys_sleep(void)
 {
   int n;
+#ifndef CS333_P3
   uint ticks0;
+#endif // CS333_P3
 
   if(argint(0, &n) < 0)
     return -1;
+#ifdef CS333_P3
+  // Sleep in the timer wheel rather than on &ticks.
+  return sleepticks(n);
+#else
   ticks0 = ticks;
   while(ticks - ticks0 < n){
     if(myproc()->killed){
@@ -78,6 +84,7 @@ sys_sleep(void)
     sleep(&ticks, (struct spinlock *)0);
   }
   return 0;
+#endif // CS333_P3
 }
 
 // return how many clock tick interrupts have occurred
@@ -209,4 +216,230 @@ sys_getpriority(void)
   }
   return getpriority(pid);
 }
+
+int
+sys_setaffinity(void)
+{
+  int pid = 0;
+  int mask = 0;
+  if((argint(0, &pid) < 0) || (argint(1, &mask) < 0))
+  {
+    return -1;
+  }
+  if(pid < 0)
+  {
+    return -1;
+  }
+  return setaffinity(pid, (uint)mask);
+}
+
+int
+sys_getaffinity(void)
+{
+  int pid = 0;
+  if(argint(0, &pid) < 0)
+  {
+    return -1;
+  }
+  if(pid < 0)
+  {
+    return -1;
+  }
+  return getaffinity(pid);
+}
+
+int
+sys_setsched(void)
+{
+  int pid = 0;
+  int class = 0;
+  int period = 0;
+  int runtime = 0;
+  if((argint(0, &pid) < 0) || (argint(1, &class) < 0) ||
+     (argint(2, &period) < 0) || (argint(3, &runtime) < 0))
+  {
+    return -1;
+  }
+  if(pid < 0 || period < 0 || runtime < 0)
+  {
+    return -1;
+  }
+  return setsched(pid, class, period, runtime);
+}
 #endif
+
+#ifdef CS333_STRIDE
+int
+sys_settickets(void)
+{
+  int pid = 0;
+  int tickets = 0;
+  if((argint(0, &pid) < 0) || (argint(1, &tickets) < 0))
+  {
+    return -1;
+  }
+  if(pid < 0 || tickets < 1 || tickets > MAXTICKETS)
+  {
+    return -1;
+  }
+  return settickets(pid, tickets);
+}
+
+int
+sys_gettickets(void)
+{
+  int pid = 0;
+  if(argint(0, &pid) < 0)
+  {
+    return -1;
+  }
+  if(pid < 0)
+  {
+    return -1;
+  }
+  return gettickets(pid);
+}
+#endif // CS333_STRIDE
+
+#ifdef CS333_SHARE
+int
+sys_setuidweight(void)
+{
+  int uid = 0;
+  int weight = 0;
+  if((argint(0, &uid) < 0) || (argint(1, &weight) < 0))
+  {
+    return -1;
+  }
+  if(uid < 0 || uid > 32767 || weight < 1 || weight > MAXUIDWEIGHT)
+  {
+    return -1;
+  }
+  return setuidweight(uid, weight);
+}
+#endif // CS333_SHARE
+
+#ifdef CS333_P4
+int
+sys_setlevel(void)
+{
+  int level = 0;
+  struct levelinfo *li;
+  struct levelinfo new;
+  if((argint(0, &level) < 0) || (argptr(1, (void*)&li, sizeof *li) < 0))
+  {
+    return -1;
+  }
+  new = *li;  // a copy another thread cannot change after the checks
+  if(level < 0 || level > MAXPRIO || new.quantum < 1 || new.quantum > MAXQUANTUM ||
+     new.budget < 1 || new.budget > BUDGET)
+  {
+    return -1;
+  }
+  return setlevel(level, &new);
+}
+
+int
+sys_getlevel(void)
+{
+  int level = 0;
+  struct levelinfo *li;
+  if((argint(0, &level) < 0) || (argptr(1, (void*)&li, sizeof *li) < 0))
+  {
+    return -1;
+  }
+  if(level < 0 || level > MAXPRIO)
+  {
+    return -1;
+  }
+  return getlevel(level, li);
+}
+#endif // CS333_P4
+
+#ifdef CS333_P3
+int
+sys_clone(void)
+{
+  int fn, arg;
+  char *stack;
+  if((argint(0, &fn) < 0) || (argint(1, &arg) < 0) ||
+     (argptr(2, &stack, PGSIZE) < 0))
+  {
+    return -1;
+  }
+  return clone((void (*)(void*))fn, (void*)arg, stack);
+}
+
+int
+sys_join(void)
+{
+  void **stack;
+  if(argptr(0, (void*)&stack, sizeof *stack) < 0)
+  {
+    return -1;
+  }
+  return join(stack);
+}
+
+int
+sys_getload(void)
+{
+  struct loadinfo *li;
+  if(argptr(0, (void*)&li, sizeof *li) < 0)
+  {
+    return -1;
+  }
+  return getload(li);
+}
+
+int
+sys_yield(void)
+{
+  return yieldto(0);
+}
+
+int
+sys_yield_to(void)
+{
+  int pid;
+  if(argint(0, &pid) < 0)
+  {
+    return -1;
+  }
+  if(pid <= 0)
+  {
+    return -1;
+  }
+  return yieldto(pid);
+}
+
+int
+sys_procsnap(void)
+{
+  uint *gen;
+  int max;
+  struct procrec *rec;
+  if((argptr(0, (void*)&gen, sizeof *gen) < 0) || (argint(1, &max) < 0) ||
+     max < 0 || max > (1 << 16) ||
+     (argptr(2, (void*)&rec, max * sizeof *rec) < 0))
+  {
+    return -1;
+  }
+  return procsnap(gen, max, rec);
+}
+
+int
+sys_setmaxproc(void)
+{
+  int n;
+  if(argint(0, &n) < 0)
+  {
+    return -1;
+  }
+  if(n < 1 || n > MAXMAXPROC)
+  {
+    return -1;
+  }
+  return setmaxproc(n);
+}
+#endif // CS333_P3
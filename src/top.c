@@ -0,0 +1,153 @@
+#ifdef CS333_P3
+#include "types.h"
+#include "user.h"
+#include "uproc.h"
+#include "pdx.h"
+
+// Show the busiest procs once a second.  Each refresh asks procsnap()
+// only for the procs that changed since the last one and keeps the
+// rest from earlier refreshes.  usage: top [refreshes]
+
+#define BATCH 32    // records per procsnap() call
+#define SHOWN 15    // procs listed per refresh
+
+static char *states[] = {
+  "unused", "embryo", "sleep", "runble", "run", "zombie"
+};
+
+static struct procrec *procs;  // latest record for each slot
+static uint *lastcpu;          // cpu_ticks of each slot at the last refresh
+static uint *lastpid;          // pid lastcpu belongs to
+static uint *delta;            // cpu_ticks used since the last refresh
+static uint nslots;
+
+static void*
+grow(void *old, uint oldsize, uint newsize)
+{
+  char *p = malloc(newsize);
+
+  memset(p, 0, newsize);
+  if(old)
+  {
+    memmove(p, old, oldsize);
+    free(old);
+  }
+  return p;
+}
+
+static void
+remember(struct procrec *r)
+{
+  uint n = nslots ? nslots : 64;
+
+  if(r->slot >= nslots)
+  {
+    while(n <= r->slot)
+      n *= 2;
+    procs = grow(procs, nslots * sizeof *procs, n * sizeof *procs);
+    lastcpu = grow(lastcpu, nslots * sizeof(uint), n * sizeof(uint));
+    lastpid = grow(lastpid, nslots * sizeof(uint), n * sizeof(uint));
+    delta = grow(delta, nslots * sizeof(uint), n * sizeof(uint));
+    nslots = n;
+  }
+  procs[r->slot] = *r;
+}
+
+static void
+hundredths(uint n)
+{
+  printf(1, "%d.%s%d", n / 100, n % 100 < 10 ? "0" : "", n % 100);
+}
+
+static void
+header(int live)
+{
+  struct loadinfo li;
+  uint secs = uptime() / TPS;
+
+  printf(1, "up %d:%s%d:%s%d, %d procs", secs / 3600,
+         secs / 60 % 60 < 10 ? "0" : "", secs / 60 % 60,
+         secs % 60 < 10 ? "0" : "", secs % 60, live);
+  if(getload(&li) == 0)
+  {
+    printf(1, ", load average: ");
+    hundredths(li.avg[0]);
+    printf(1, ", ");
+    hundredths(li.avg[1]);
+    printf(1, ", ");
+    hundredths(li.avg[2]);
+  }
+  printf(1, "\nPID\tNAME            STATE\tPRIO\tCPU%%\tTIME\n");
+}
+
+static void
+refresh(uint interval)
+{
+  struct procrec batch[BATCH];
+  static uint gen;
+  struct procrec *r;
+  int i, n, live = 0, best;
+  uint s;
+
+  do {
+    n = procsnap(&gen, BATCH, batch);
+    for(i = 0; i < n; i++)
+      remember(&batch[i]);
+  } while(n == BATCH);
+
+  for(s = 0; s < nslots; s++)
+  {
+    if(procs[s].pid == 0)
+      continue;
+    live++;
+    if(lastpid[s] != procs[s].pid)
+      lastcpu[s] = 0;
+    delta[s] = procs[s].cpu_ticks - lastcpu[s];
+    lastcpu[s] = procs[s].cpu_ticks;
+    lastpid[s] = procs[s].pid;
+  }
+
+  header(live);
+  for(i = 0; i < SHOWN; i++)
+  {
+    best = -1;
+    for(s = 0; s < nslots; s++)
+    {
+      if(procs[s].pid != 0 && delta[s] != (uint)-1 &&
+         (best < 0 || delta[s] > delta[best]))
+        best = s;
+    }
+    if(best < 0)
+      break;
+    r = &procs[best];
+    printf(1, "%d\t%s", r->pid, r->name);
+    for(n = strlen(r->name); n < 16; n++)
+      printf(1, " ");
+    printf(1, "%s\t%d\t%d\t%d.%s%d\n", states[r->state], r->priority,
+           interval ? delta[best] * 100 / interval : 0,
+           r->cpu_ticks / TPS, r->cpu_ticks % TPS < 100 ?
+           (r->cpu_ticks % TPS < 10 ? "00" : "0") : "",
+           r->cpu_ticks % TPS);
+    delta[best] = (uint)-1;  // listed
+  }
+  printf(1, "\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+  int count = argc > 1 ? atoi(argv[1]) : 0;
+  uint last = uptime();
+  uint now;
+
+  refresh(0);
+  while(count <= 0 || --count > 0)
+  {
+    sleep(TPS);
+    now = uptime();
+    refresh(now - last);
+    last = now;
+  }
+  exit();
+}
+#endif // CS333_P3
@@ -20,6 +20,76 @@ struct spinlock tickslock;
 uint ticks;
 #endif // PDX_XV6
 
+#ifdef CS333_P3
+// Tickless clock.  Until the TSC is calibrated cpu 0 counts timer
+// interrupts as before.  Afterwards any cpu's timer interrupt derives
+// ticks from the TSC, so ticks stays right while idle cpus run their
+// LAPIC timers in one-shot mode and skip ticks.
+#define CLOCK_CALSTART 10    // let the first few ticks settle
+#define CLOCK_CALTICKS 100   // ticks to measure the TSC over
+
+static struct {
+  uint64 tsc0;        // TSC when ticks was tick0
+  uint tick0;
+  volatile uint tsctick;  // TSC cycles per tick, 0 until calibrated
+} clock;
+
+int
+clockcalibrated(void)
+{
+  return clock.tsctick != 0;
+}
+
+// Convert a TSC interval to microseconds.  Only meaningful once the
+// clock is calibrated.
+uint
+tscusec(uint64 cycles)
+{
+  uint perusec = clock.tsctick / (1000000 / TPS);
+
+  return div64(cycles, perusec ? perusec : 1);
+}
+
+// Convert a TSC interval to ticks.
+uint
+tscticks(uint64 cycles)
+{
+  return div64(cycles, clock.tsctick ? clock.tsctick : 1);
+}
+
+static void
+clockupdate(void)
+{
+  uint64 tsc;
+  uint now, old, cal;
+
+  if(clock.tsctick == 0){
+    if(cpuid() != 0)
+      return;
+    atom_inc((int *)&ticks);
+    if(ticks == CLOCK_CALSTART){
+      clock.tsc0 = rdtsc();
+    } else if(ticks == CLOCK_CALSTART + CLOCK_CALTICKS){
+      tsc = rdtsc();
+      clock.tick0 = ticks;
+      cal = (uint)(tsc - clock.tsc0) / CLOCK_CALTICKS;
+      clock.tsc0 = tsc;
+      __sync_synchronize();  // publish tsc0 and tick0 before tsctick
+      clock.tsctick = cal;
+    }
+    return;
+  }
+
+  now = clock.tick0 + div64(rdtsc() - clock.tsc0, clock.tsctick);
+  // Several cpus may race to advance ticks; it only moves forward.
+  do {
+    old = ticks;
+    if((int)(now - old) <= 0)
+      return;
+  } while(cmpxchg(&ticks, old, now) != old);
+}
+#endif // CS333_P3
+
 void
 tvinit(void)
 {
@@ -50,11 +120,31 @@ trap(struct trapframe *tf)
     syscall();
     if(myproc()->killed)
       exit();
+#ifdef CS333_P4
+    // The call may have woken a proc that should run here instead.
+    if(preemptdue(0))
+      yield();
+#endif // CS333_P4
     return;
   }
 
+#ifdef CS333_P3
+  // A tickless cpu's periodic timer is off, so an interrupt that ends
+  // its idle must bring ticks and the timer wheel up to date itself.
+  if(tf->trapno >= T_IRQ0 && tf->trapno != T_IRQ0+IRQ_TIMER &&
+     mycpu()->tickless){
+    clockupdate();
+    timertick();
+  }
+#endif // CS333_P3
+
   switch(tf->trapno){
   case T_IRQ0 + IRQ_TIMER:
+#ifdef CS333_P3
+    mycpu()->armed = 0;
+    clockupdate();
+    timertick();
+#else
     if(cpuid() == 0){
 #ifdef PDX_XV6
       atom_inc((int *)&ticks);
@@ -66,8 +156,15 @@ trap(struct trapframe *tf)
       release(&tickslock);
 #endif // PDX_XV6
     }
+#endif // CS333_P3
     lapiceoi();
     break;
+#ifdef CS333_P4
+  case T_IRQ0 + IRQ_RESCHED:
+    // Nothing to do here; preemptdue() below sees the request.
+    lapiceoi();
+    break;
+#endif // CS333_P4
   case T_IRQ0 + IRQ_IDE:
     ideintr();
     lapiceoi();
@@ -114,7 +211,9 @@ trap(struct trapframe *tf)
   // Force process to give up CPU on clock tick.
   // If interrupts were on while locks held, would need to check nlock.
   if(myproc() && myproc()->state == RUNNING &&
-#ifdef PDX_XV6
+#if defined(CS333_P4)
+    preemptdue(tf->trapno == T_IRQ0+IRQ_TIMER))
+#elif defined(PDX_XV6)
     tf->trapno == T_IRQ0+IRQ_TIMER && ticks%SCHED_INTERVAL==0)
 #else
     tf->trapno == T_IRQ0+IRQ_TIMER)
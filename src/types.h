@@ -1,6 +1,7 @@
 typedef unsigned int   uint;
 typedef unsigned short ushort;
 typedef unsigned char  uchar;
+typedef unsigned long long uint64;
 typedef uint pde_t;
 #ifdef PDX_XV6
 #include "pdx.h"
@@ -1,3 +1,5 @@
+#include "param.h"  // NCPU
+
 #define STRMAX 32
 
 struct uproc {
@@ -7,11 +9,58 @@ struct uproc {
   uint ppid;
 #ifdef CS333_P4
   uint priority;
+  int cpu;                     // cpu the proc is on or last ran on, -1 if none
+  uint sched;                  // scheduling class, SCHED_MLFQ etc.
 #endif // CS333_P4
+#ifdef CS333_STRIDE
+  uint tickets;
+#endif // CS333_STRIDE
+#ifdef CS333_SHARE
+  uint uidweight;
+  uint uidshare;               // thousandths of recent cpu used by the uid
+#endif // CS333_SHARE
   uint elapsed_ticks;
   uint CPU_total_ticks;
+#ifdef CS333_P3
+  uint CPU_usec;               // microseconds past CPU_total_ticks
+#endif // CS333_P3
   char state[STRMAX];
   uint size;
   char name[STRMAX];
 };
 
+#ifdef CS333_P4
+// A priority level's time slice, and the cpu time a proc may use at
+// the level before it drops to the next, both in ticks.
+struct levelinfo {
+  uint quantum;
+  uint budget;
+};
+#endif // CS333_P4
+
+#ifdef CS333_P3
+// Fixed-width record filled by procsnap().  A slot never changes its
+// proc; pid is 0 once the slot's proc has been reaped.
+struct procrec {
+  uint slot;
+  uint pid;
+  uint ppid;
+  uint uid;
+  uint size;
+  uint cpu_ticks;
+  uint start_ticks;
+  uchar state;                 // enum procstate
+  uchar priority;
+  char cpu;                    // cpu the proc last ran on, -1 if none
+  uchar sched;
+  char name[16];
+};
+
+struct loadinfo {
+  uint avg[3];                 // 1, 5 and 15 minute load averages x 100
+  uint ncpu;
+  uint busy[NCPU];             // ticks each cpu spent running procs
+  uint idle[NCPU];             // ticks each cpu spent halted
+};
+#endif // CS333_P3
+
@@ -0,0 +1,45 @@
+#ifdef CS333_P3
+#include "types.h"
+#include "user.h"
+#include "uproc.h"
+#include "pdx.h"
+
+// Print how long the system has been up, the 1, 5 and 15 minute load
+// averages and how busy each cpu has been.
+
+static void
+hundredths(uint n)
+{
+  printf(1, "%d.%s%d", n / 100, n % 100 < 10 ? "0" : "", n % 100);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct loadinfo li;
+  uint secs = uptime() / TPS;
+  uint total;
+  int i;
+
+  if(getload(&li) < 0)
+  {
+    printf(2, "uptime: getload failed\n");
+    exit();
+  }
+  printf(1, "up %d:%s%d:%s%d, load average: ", secs / 3600,
+         secs / 60 % 60 < 10 ? "0" : "", secs / 60 % 60,
+         secs % 60 < 10 ? "0" : "", secs % 60);
+  for(i = 0; i < 3; i++)
+  {
+    hundredths(li.avg[i]);
+    printf(1, i < 2 ? ", " : "\n");
+  }
+  for(i = 0; i < li.ncpu; i++)
+  {
+    total = li.busy[i] + li.idle[i];
+    printf(1, "cpu%d: %d%% busy\n", i,
+           total >= 100 ? li.busy[i] / (total / 100) : 0);
+  }
+  exit();
+}
+#endif // CS333_P3
@@ -1,6 +1,9 @@
 struct stat;
 struct rtcdate;
 struct uproc;
+struct loadinfo;
+struct procrec;
+struct levelinfo;
 
 // system calls
 int fork(void);
@@ -42,6 +45,29 @@ int getprocs(uint, struct uproc*);
 #ifdef CS333_P4
 int setpriority(int, int);
 int getpriority(int);
+int setaffinity(int, uint);
+int getaffinity(int);
+int setsched(int, int, uint, uint);
+#endif // CS333_P4
+#ifdef CS333_STRIDE
+int settickets(int, int);
+int gettickets(int);
+#endif // CS333_STRIDE
+#ifdef CS333_P3
+int clone(void (*)(void*), void*, void*);
+int join(void**);
+int getload(struct loadinfo*);
+int yield(void);
+int yield_to(int);
+int procsnap(uint*, int, struct procrec*);
+int setmaxproc(int);
+#endif // CS333_P3
+#ifdef CS333_SHARE
+int setuidweight(int, int);
+#endif // CS333_SHARE
+#ifdef CS333_P4
+int setlevel(int, struct levelinfo*);
+int getlevel(int, struct levelinfo*);
 #endif // CS333_P4
 
 // ulib.c
@@ -60,4 +86,10 @@ int atoi(const char*);
 #ifdef PDX_XV6
 int atoo(const char*);
 int strncmp(const char*, const char*, uint);
+int check(int, char*);
 #endif // PDX_XV6
+#ifdef CS333_P4
+int spinner(uint);
+void spinrun(int, int*, uint*);
+int ratiook(uint, uint, int, int);
+#endif // CS333_P4
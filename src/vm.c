@@ -21,12 +21,22 @@ seginit(void)
   // Cannot share a CODE descriptor for both kernel and user
   // because it would have to have DPL_USR, but the CPU forbids
   // an interrupt from CPL=0 to DPL=3.
-  c = &cpus[cpuid()];
+  // mycpu() needs %gs, so find this cpu by its APIC ID.
+  for(c = cpus; c < &cpus[ncpu] && c->apicid != lapicid(); c++)
+    ;
+  if(c == &cpus[ncpu])
+    panic("seginit: unknown apicid");
   c->gdt[SEG_KCODE] = SEG(STA_X|STA_R, 0, 0xffffffff, 0);
   c->gdt[SEG_KDATA] = SEG(STA_W, 0, 0xffffffff, 0);
   c->gdt[SEG_UCODE] = SEG(STA_X|STA_R, 0, 0xffffffff, DPL_USER);
   c->gdt[SEG_UDATA] = SEG(STA_W, 0, 0xffffffff, DPL_USER);
+
+  // Per-cpu segment: kernel code reaches c through %gs, which alltraps
+  // reloads on every entry from user space.
+  c->gdt[SEG_KCPU] = SEG(STA_W, c, sizeof(*c) - 1, 0);
   lgdt(c->gdt, sizeof(c->gdt));
+  c->self = c;
+  loadgs(SEG_KCPU << 3);
 }
 
 // Return the address of the PTE in page table pgdir
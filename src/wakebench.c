@@ -0,0 +1,144 @@
+#ifdef CS333_P2
+#include "types.h"
+#include "user.h"
+#include "param.h"
+#include "pdx.h"
+
+// Times pipe round trips between two procs, first with few other procs
+// and then with many procs asleep on other channels that every wakeup
+// has to pass over.  Each round trip is two sleeps and two wakeups, so
+// the difference is what the extra procs add to those paths, which read
+// the hot fields of struct proc.  Run it on builds before and after a
+// change to struct proc to compare them.
+//
+// Without the P3 sleep queues wakeup1() scans the whole proc table, so
+// the table is filled with procs blocked on one pipe.  With them it
+// walks only the hash bucket of the channel, so the sleepers use
+// sleep(), which gives each a channel of its own; those spread over the
+// buckets, and about PARK / 64 share each bucket the round trips wake.
+// usage: wakebench [rounds [sleepers]]
+
+#define ROUNDS 10000
+#define SPARE 4    // slots left for init, sh, this proc and its partner
+#ifdef CS333_P3
+#define PARK 512
+#else
+#define PARK (NPROC - SPARE)
+#endif // CS333_P3
+
+static void
+hundredths(uint n)
+{
+  printf(1, "%d.%s%d", n / 100, n % 100 < 10 ? "0" : "", n % 100);
+}
+
+// Round trips between this proc and a child, in ticks.
+static uint
+pingpong(int rounds)
+{
+  int up[2], down[2], pid, i;
+  char c = 0;
+  uint start;
+
+  pipe(up);
+  pipe(down);
+  pid = fork();
+  if(pid == 0)
+  {
+    close(up[0]);
+    close(down[1]);
+    while(read(down[0], &c, 1) == 1)
+      write(up[1], &c, 1);
+    exit();
+  }
+  close(up[1]);
+  close(down[0]);
+#ifdef CS333_P4
+  setaffinity(pid, 1);  // same cpu as the parent, so no IPIs are timed
+#endif // CS333_P4
+  start = uptime();
+  for(i = 0; i < rounds; i++)
+  {
+    write(down[1], &c, 1);
+    read(up[0], &c, 1);
+  }
+  start = uptime() - start;
+  close(down[1]);
+  close(up[0]);
+  wait();
+  return start;
+}
+
+static void
+report(char *what, int rounds, uint elapsed)
+{
+  printf(1, "%s: %d round trips in %d ticks, ", what, rounds, elapsed);
+  hundredths(elapsed * (100000 / TPS) * 1000 / rounds);
+  printf(1, " us each\n");
+}
+
+// Sleep until killed, reading fd where sleep() would wake every tick.
+static void
+park(int fd)
+{
+#ifdef CS333_P3
+  sleep(1000 * TPS);
+#else
+  char c;
+
+  read(fd, &c, 1);
+#endif // CS333_P3
+  exit();
+}
+
+int
+main(int argc, char *argv[])
+{
+  int rounds = argc > 1 ? atoi(argv[1]) : ROUNDS;
+  int nsleep = argc > 2 ? atoi(argv[2]) : PARK;
+  int *pids, n, pid, fd[2];
+#ifdef CS333_P3
+  int oldmax;
+#endif // CS333_P3
+
+  if(rounds <= 0)
+    rounds = ROUNDS;
+  if(nsleep <= 0)
+    nsleep = PARK;
+#ifdef CS333_P4
+  setaffinity(getpid(), 1);
+#endif // CS333_P4
+  report("alone", rounds, pingpong(rounds));
+
+#ifdef CS333_P3
+  oldmax = setmaxproc(nsleep + SPARE);
+#endif // CS333_P3
+  pipe(fd);  // never written
+  pids = malloc(nsleep * sizeof(int));
+  for(n = 0; n < nsleep; n++)
+  {
+    pid = fork();
+    if(pid < 0)
+      break;
+    if(pid == 0)
+      park(fd[0]);
+    pids[n] = pid;
+  }
+  printf(1, "%d procs sleeping\n", n);
+  report("full", rounds, pingpong(rounds));
+
+  while(n-- > 0)
+  {
+    kill(pids[n]);
+    wait();
+  }
+#ifdef CS333_P3
+  if(oldmax > 0)
+    setmaxproc(oldmax);
+#endif // CS333_P3
+  close(fd[0]);
+  close(fd[1]);
+  free(pids);
+  exit();
+}
+#endif // CS333_P2
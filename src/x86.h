@@ -134,6 +134,27 @@ xchg(volatile uint *addr, uint newval)
   return result;
 }
 
+static inline uint
+cmpxchg(volatile uint *addr, uint oldval, uint newval)
+{
+  uint result;
+
+  asm volatile("lock; cmpxchgl %2, %0" :
+               "+m" (*addr), "=a" (result) :
+               "r" (newval), "1" (oldval) :
+               "cc");
+  return result;
+}
+
+static inline uint64
+rdtsc(void)
+{
+  uint64 tsc;
+
+  asm volatile("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
 static inline uint
 rcr2(void)
 {